@@ -2,12 +2,42 @@
 #include <algorithm>
 #include <cassert>
 #include <cmath>
-#include <complex>
+#include <cstdint>
 #include <deque>
 #include <iomanip>
 #include <iostream>
 #include <string>
+#include <type_traits>
 #include <vector>
+#include "fft.h"
+
+namespace BinaryFormat { //fixed-width little-endian words, the building block of every binary record
+
+template<typename Word>
+void write(std::ostream& out, Word word) {
+  static_assert(std::is_unsigned_v<Word>, "binary words are unsigned");
+  char bytes[sizeof(Word)];
+  for (size_t i = 0; i < sizeof(Word); ++i) {
+    bytes[i] = static_cast<char>((word >> (8 * i)) & 0xFF);
+  }
+  out.write(bytes, sizeof(Word));
+}
+
+template<typename Word>
+bool read(const unsigned char*& cursor, const unsigned char* end, Word& word) { //false if fewer than sizeof(Word) bytes are left
+  static_assert(std::is_unsigned_v<Word>, "binary words are unsigned");
+  if (static_cast<size_t>(end - cursor) < sizeof(Word)) {
+    return false;
+  }
+  word = 0;
+  for (size_t i = 0; i < sizeof(Word); ++i) {
+    word = static_cast<Word>(word | static_cast<Word>(static_cast<Word>(cursor[i]) << (8 * i)));
+  }
+  cursor += sizeof(Word);
+  return true;
+}
+
+}
 
 class BigInteger {
 public:
@@ -248,6 +278,59 @@ public:
     digits_.swap(rhs.digits_);
   }
 
+  //sign byte, limb count and the base-kBase limbs from the least significant one, as little-endian 32-bit words
+  void writeBinary(std::ostream& out) const {
+    BinaryFormat::write<uint8_t>(out, isNegative_ ? 1 : 0);
+    BinaryFormat::write<uint32_t>(out, static_cast<uint32_t>(digits_.size()));
+    for (auto digit : digits_) {
+      BinaryFormat::write<uint32_t>(out, static_cast<uint32_t>(digit));
+    }
+  }
+
+  //decodes a record written by writeBinary from memory (e.g. a mapped file) and advances cursor past it
+  static bool readBinary(const unsigned char*& cursor, const unsigned char* end, BigInteger& result) {
+    uint8_t sign = 0;
+    uint32_t size = 0;
+    if (!BinaryFormat::read(cursor, end, sign) || !BinaryFormat::read(cursor, end, size)
+        || sign > 1 || static_cast<size_t>(end - cursor) / sizeof(uint32_t) < size) {
+      return false;
+    }
+    result.digits_.resize(size);
+    for (auto& digit : result.digits_) {
+      uint32_t limb = 0;
+      BinaryFormat::read(cursor, end, limb);
+      if (limb >= kBase) {
+        return false;
+      }
+      digit = limb;
+    }
+    result.isNegative_ = sign == 1;
+    result.normalize();
+    return true;
+  }
+
+  //the limbs are read in chunks of at most kBinaryChunk bytes, so a corrupt limb count cannot allocate more than the stream holds
+  static bool readBinary(std::istream& in, BigInteger& result) {
+    std::vector<unsigned char> buffer(sizeof(uint8_t) + sizeof(uint32_t));
+    if (!in.read(reinterpret_cast<char*>(buffer.data()), static_cast<std::streamsize>(buffer.size()))) {
+      return false;
+    }
+    const unsigned char* cursor = buffer.data() + sizeof(uint8_t);
+    uint32_t size = 0;
+    BinaryFormat::read(cursor, buffer.data() + buffer.size(), size);
+    for (size_t remaining = static_cast<size_t>(size) * sizeof(uint32_t); remaining > 0;) {
+      const size_t chunk = std::min(remaining, kBinaryChunk);
+      const size_t offset = buffer.size();
+      buffer.resize(offset + chunk);
+      if (!in.read(reinterpret_cast<char*>(buffer.data() + offset), static_cast<std::streamsize>(chunk))) {
+        return false;
+      }
+      remaining -= chunk;
+    }
+    cursor = buffer.data();
+    return readBinary(cursor, buffer.data() + buffer.size(), result);
+  }
+
   friend class Rational;
 
 #ifdef LOCAL
@@ -259,7 +342,8 @@ private:
 
   static const int64_t kBase = 1e5;
   static const int64_t kPow = 5;
-  static const size_t kShortNumber = 10000;
+  static const size_t kShortNumber = 64;
+  static constexpr size_t kBinaryChunk = 1 << 16;
   std::deque<integerType> digits_;
   bool isNegative_ = false;
 
@@ -291,55 +375,6 @@ private:
     }
   }
 
-  static void precalcWs(double phi, size_t kLength, std::vector<std::complex<double>> &rootDegrees) {
-    rootDegrees.front() = 1;
-    for (size_t i = 1; i < kLength; ++i) {
-      rootDegrees[i] = std::complex(cos(phi * static_cast<double>(i)), sin(phi *  static_cast<double>(i)));
-    }
-  }
-
-  static void fastFourierTransform(std::vector<std::complex<double>> &polynomial, const int kLength,
-                                   const int kLogLength, std::vector<std::complex<double>> &rootDegrees,
-                                   std::vector<std::complex<double>> &temporaryLayer) {
-    reorder(polynomial, static_cast<size_t>(kLength), kLogLength);
-    int blockLengthLog = 0;
-    int layerIndex = kLength >> 1;
-    while ((1 << blockLengthLog) < kLength) {
-      int blockLength = 1 << blockLengthLog;
-      int newBlockLength = blockLength << 1;
-      for (int i = 0; i < kLength; ++i) {
-        int startBlockIndex = i - (i & (newBlockLength - 1));
-        int indexInBlock = i & (newBlockLength - 1);
-        temporaryLayer[static_cast<size_t>(i)] =
-          polynomial[static_cast<size_t>(startBlockIndex + (indexInBlock & (blockLength - 1)))] +
-            rootDegrees[static_cast<size_t>(1LL * layerIndex * indexInBlock % kLength)] *
-              polynomial[static_cast<size_t>((1 << blockLengthLog) + startBlockIndex + (indexInBlock & (blockLength - 1)))];
-      }
-      polynomial.swap(temporaryLayer);
-      blockLengthLog++;
-      layerIndex >>= 1;
-    }
-  }
-
-  static void reorder(std::vector<std::complex<double>> &polynomial, size_t kLength, int kLogLength) {
-    for (size_t i = 0; i < kLength; ++i) {
-      int reversedIndex = reverseInt(static_cast<int>(i), kLogLength);
-      if (reversedIndex < static_cast<int>(i)) {
-        std::swap(polynomial[i], polynomial[static_cast<size_t>(reversedIndex)]);
-      }
-    }
-  }
-
-  static int reverseInt(int number, int log2kLength) {
-    --log2kLength;
-    int result = 0;
-    for (int bit = 0; bit < log2kLength; ++bit) {
-      if ((number >> bit) & 1)
-        result |= (1 << (log2kLength - 1 - bit));
-    }
-    return result;
-  }
-
   static BigInteger multiply(BigInteger lhs, integerType rhs) {
     lhs.digits_.push_back(0);
     for (ssize_t i = static_cast<ssize_t>(lhs.digits_.size()) - 2; i > -1; --i) {
@@ -374,56 +409,20 @@ private:
     isNegative_ = resultSign == -1;
   }
 
+  //limb products are summed exactly by the shared number theoretic transform, see fft.h
   void fastMultiply(const BigInteger& rhs, size_t kLength, int resultSign) {
-    while (__builtin_popcount(static_cast<unsigned int>(kLength)) != 1) {
-      ++kLength;
-    }
-
-    std::vector<std::complex<double>> leftMultiplier(kLength);
-    std::vector<std::complex<double>> rightMultiplier(kLength);
-    std::vector<std::complex<double>> temporaryLayer(kLength);
-    std::vector<std::complex<double>> rootDegrees(kLength);
-
-    for (size_t i = 0; i < kLength; ++i) {
-      if (i < digits_.size()) {
-        leftMultiplier[i] = static_cast<double>(digits_[i]);
-      } else {
-        leftMultiplier[i] = 0;
-      }
-    }
-    for (size_t i = 0; i < kLength; ++i) {
-      if (i < rhs.digits_.size()) {
-        rightMultiplier[i] = static_cast<double>(rhs.digits_[i]);
-      } else {
-        rightMultiplier[i] = 0;
-      }
-    }
-
-    const int kLogLength = sizeof(kLength) * 8 - static_cast<size_t>(__builtin_clz(static_cast<unsigned int>(kLength)));
-    const double kPhi = 2.0 * acos(-1.0) / static_cast<double>(kLength);
-
-    precalcWs(kPhi, kLength, rootDegrees);
-    fastFourierTransform(leftMultiplier, static_cast<int>(kLength), kLogLength, rootDegrees, temporaryLayer);
-    fastFourierTransform(rightMultiplier, static_cast<int>(kLength), kLogLength, rootDegrees, temporaryLayer);
-    for (size_t i = 0; i < kLength; i++) {
-      leftMultiplier[i] = leftMultiplier[i] * rightMultiplier[i];
-    }
-
-    precalcWs(-kPhi, kLength, rootDegrees);
-    fastFourierTransform(leftMultiplier, static_cast<int>(kLength), kLogLength, rootDegrees, temporaryLayer);
-    for (size_t i = 0; i < kLength; i++) {
-      leftMultiplier[i] /= static_cast<double>(kLength);
-    }
+    const std::vector<uint64_t> leftMultiplier(digits_.begin(), digits_.end());
+    const std::vector<uint64_t> rightMultiplier(rhs.digits_.begin(), rhs.digits_.end());
+    const std::vector<uint64_t> product = Transform::convolveModulo(leftMultiplier, rightMultiplier, 0);
 
     isNegative_ = resultSign == -1;
-    const size_t kDigitsSize = kLength;
-    digits_.resize(kDigitsSize);
-    int64_t cur = 0;
-    for (size_t i = 0; i < kDigitsSize; i++) {
-      if (i < kLength) {
-        cur += static_cast<int64_t>(round(leftMultiplier[i].real()));
+    digits_.resize(kLength);
+    uint64_t cur = 0;
+    for (size_t i = 0; i < kLength; i++) {
+      if (i < product.size()) {
+        cur += product[i];
       }
-      digits_[i] = cur % kBase;
+      digits_[i] = static_cast<integerType>(cur % kBase);
       cur /= kBase;
     }
   }
@@ -437,6 +436,32 @@ private:
       return;
     }
     isNegative_ = resultSign == -1;
+    if (lhs.digits_.size() < rhs.digits_.size()) { //|lhs| < |rhs|: the quotient is zero and the remainder is lhs
+      if (doReturnWholePart) {
+        digits_.assign(1, 0);
+        normalize();
+      } else {
+        swap(lhs);
+      }
+      return;
+    }
+    if (rhs.digits_.size() == 1) { //one-limb divisor: short division, no binary search per quotient limb
+      const integerType divisor = rhs.digits_[0];
+      integerType remainder = 0;
+      for (size_t i = lhs.digits_.size(); i-- > 0;) {
+        const integerType current = remainder * kBase + lhs.digits_[i];
+        lhs.digits_[i] = current / divisor;
+        remainder = current % divisor;
+      }
+      if (doReturnWholePart) {
+        digits_.swap(lhs.digits_);
+      } else {
+        digits_.assign(1, remainder);
+        isNegative_ = leftSign == -1;
+      }
+      normalize();
+      return;
+    }
     int currentPower = 0;
     lhs.isNegative_ = rhs.isNegative_ = false;
     while (rhs.digits_.size() < lhs.digits_.size()) {
@@ -541,24 +566,28 @@ public:
     this->numerator_ *= rhs.denominator_;
     this->numerator_ += rhs.numerator_ * denominator_;
     this->denominator_ *= rhs.denominator_;
+    normalize();
     return *this;
   }
 
   Rational& operator-=(const Rational& rhs) {
     this->numerator_ = numerator_ * rhs.denominator_ - rhs.numerator_ * denominator_;
     this->denominator_ = denominator_ * rhs.denominator_;
+    normalize();
     return *this;
   }
 
   Rational& operator/=(const Rational& rhs) {
     this->numerator_ *= rhs.denominator_;
     this->denominator_ *= rhs.numerator_;
+    normalize();
     return *this;
   }
 
   Rational& operator*=(const Rational& rhs) {
     this->numerator_ *= rhs.numerator_;
     this->denominator_ *= rhs.denominator_;
+    normalize();
     return *this;
   }
 
@@ -618,34 +647,21 @@ public:
     size_t symbolsToDelete = (precision + BigInteger::kPow - 1) / BigInteger::kPow * BigInteger::kPow - precision;
     divisible /= denominator_;
     std::string result = divisible.toString();
-    for (size_t i = 0; i < symbolsToDelete ; ++i) {
-      result.pop_back();
+    const bool isNegative = result.front() == '-';
+    if (isNegative) {
+      result.erase(result.begin());
     }
+    const size_t fractionDigits = precision + symbolsToDelete;
+    if (result.size() <= fractionDigits) { //less than one: at least one integer digit, zeros after the point
+      result.insert(0, fractionDigits + 1 - result.size(), '0');
+    }
+    result.resize(result.size() - symbolsToDelete);
 
     if (precision > 0) {
-      result += '.';
-      std::reverse(result.begin(), result.end());
-      bool isNegative = false;
-      if (result.back() == '-') {
-        isNegative = true;
-        result.pop_back();
-      }
-
-      size_t pointPointer = 0;
-      for (size_t i = 0; i < precision; ++i) {
-        if (pointPointer + 1 == result.size()) {
-          result.push_back('0');
-        }
-        std::swap(result[pointPointer], result[pointPointer + 1]);
-        pointPointer++;
-      }
-      if (result.back() == '.') {
-        result.push_back('0');
-      }
-      if (isNegative) {
-        result.push_back('-');
-      }
-      std::reverse(result.begin(), result.end());
+      result.insert(result.size() - precision, 1, '.');
+    }
+    if (isNegative) {
+      result.insert(result.begin(), '-');
     }
     return result;
   }
@@ -659,6 +675,26 @@ public:
     return stod(asDecimal(kPrecision));
   }
 
+  void writeBinary(std::ostream& out) const { //numerator and denominator records of BigInteger::writeBinary, the fraction is kept reduced
+    numerator_.writeBinary(out);
+    denominator_.writeBinary(out);
+  }
+
+  //the denominator must be positive; a fraction that is not reduced (e.g. 2/4) is reduced, operator== relies on it
+  static bool readBinary(const unsigned char*& cursor, const unsigned char* end, Rational& result) {
+    if (!BigInteger::readBinary(cursor, end, result.numerator_) || !BigInteger::readBinary(cursor, end, result.denominator_)) {
+      return false;
+    }
+    return result.finishBinaryRead();
+  }
+
+  static bool readBinary(std::istream& in, Rational& result) {
+    if (!BigInteger::readBinary(in, result.numerator_) || !BigInteger::readBinary(in, result.denominator_)) {
+      return false;
+    }
+    return result.finishBinaryRead();
+  }
+
   Rational (const BigInteger& num, const BigInteger& den)
     : numerator_(num)
     , denominator_(den) {
@@ -677,6 +713,14 @@ private:
     return greatestCommonDivisor(rhs %= lhs,lhs);
   }
 
+  bool finishBinaryRead() {
+    if (denominator_.signum() != 1) {
+      return false;
+    }
+    normalize();
+    return true;
+  }
+
   void normalize() const {
     int sign = numerator_.signum() * denominator_.signum();
     numerator_.isNegative_ = denominator_.isNegative_ = false;
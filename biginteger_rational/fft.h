@@ -0,0 +1,268 @@
+#pragma once
+#include <algorithm>
+#include <bit>
+#include <cassert>
+#include <cmath>
+#include <complex>
+#include <cstddef>
+#include <cstdint>
+#include <numbers>
+#include <vector>
+
+//Fast convolutions shared by BigInteger and Polynomial: a complex FFT for floating point coefficients
+//and number theoretic transforms for exact integer and modular ones.
+namespace Transform {
+
+inline size_t transformLength(size_t resultSize) { //smallest power of two not less than resultSize
+  size_t length = 1;
+  while (length < resultSize) {
+    length <<= 1;
+  }
+  return length;
+}
+
+template<typename Value>
+void reorderBitReversed(std::vector<Value>& values) {
+  const size_t length = values.size();
+  for (size_t i = 1, reversed = 0; i < length; ++i) {
+    size_t bit = length >> 1;
+    for (; reversed & bit; bit >>= 1) {
+      reversed ^= bit;
+    }
+    reversed ^= bit;
+    if (i < reversed) {
+      std::swap(values[i], values[reversed]);
+    }
+  }
+}
+
+class ComplexTransform {
+public:
+  using Complex = std::complex<double>;
+
+  static void transform(std::vector<Complex>& values, bool inverse) { //in place, values.size() must be a power of two
+    const size_t length = values.size();
+    reorderBitReversed(values);
+    const std::vector<Complex> roots = rootsOfUnity(length, inverse);
+    for (size_t blockLength = 2; blockLength <= length; blockLength <<= 1) {
+      const size_t half = blockLength >> 1;
+      const size_t step = length / blockLength;
+      for (size_t start = 0; start < length; start += blockLength) {
+        for (size_t k = 0; k < half; ++k) {
+          const Complex even = values[start + k];
+          const Complex odd = values[start + k + half] * roots[k * step];
+          values[start + k] = even + odd;
+          values[start + k + half] = even - odd;
+        }
+      }
+    }
+    if (inverse) {
+      for (Complex& value : values) {
+        value /= static_cast<double>(length);
+      }
+    }
+  }
+
+  //lhs goes to the real and rhs to the imaginary part, so one forward transform serves both factors
+  static std::vector<double> convolve(const std::vector<double>& lhs, const std::vector<double>& rhs) {
+    if (lhs.empty() || rhs.empty()) {
+      return {};
+    }
+    const size_t resultSize = lhs.size() + rhs.size() - 1;
+    const size_t length = transformLength(resultSize);
+    std::vector<Complex> packed(length);
+    for (size_t i = 0; i < lhs.size(); ++i) {
+      packed[i].real(lhs[i]);
+    }
+    for (size_t i = 0; i < rhs.size(); ++i) {
+      packed[i].imag(rhs[i]);
+    }
+    transform(packed, false);
+
+    std::vector<Complex> product(length);
+    const Complex fourI(0, 4);
+    for (size_t k = 0; k < length; ++k) { //with P = A + iB and conj(P[-k]) = A - iB: A * B = (P^2 - conj(P[-k])^2) / 4i
+      const Complex mirrored = std::conj(packed[(length - k) & (length - 1)]);
+      product[k] = (packed[k] * packed[k] - mirrored * mirrored) / fourI;
+    }
+    transform(product, true);
+
+    std::vector<double> result(resultSize);
+    for (size_t i = 0; i < resultSize; ++i) {
+      result[i] = product[i].real();
+    }
+    return result;
+  }
+
+private:
+  static std::vector<Complex> rootsOfUnity(size_t length, bool inverse) { //each root from cos/sin directly, no accumulated error
+    std::vector<Complex> roots(std::max<size_t>(length / 2, 1));
+    const double angle = (inverse ? -2.0 : 2.0) * std::numbers::pi / static_cast<double>(length);
+    for (size_t k = 0; k < roots.size(); ++k) {
+      roots[k] = std::polar(1.0, angle * static_cast<double>(k));
+    }
+    return roots;
+  }
+};
+
+constexpr uint64_t powerModuloPrime(uint64_t base, uint64_t exponent, uint64_t prime) { //prime below 2^32
+  uint64_t result = 1;
+  base %= prime;
+  while (exponent > 0) {
+    if (exponent & 1) {
+      result = result * base % prime;
+    }
+    base = base * base % prime;
+    exponent >>= 1;
+  }
+  return result;
+}
+
+constexpr uint64_t primitiveRoot(uint64_t prime) { //zero if prime is composite
+  uint64_t factors[32] = {};
+  size_t factorCount = 0;
+  uint64_t rest = prime - 1;
+  for (uint64_t divisor = 2; divisor * divisor <= rest; ++divisor) {
+    if (rest % divisor == 0) {
+      factors[factorCount++] = divisor;
+      while (rest % divisor == 0) {
+        rest /= divisor;
+      }
+    }
+  }
+  if (rest > 1) {
+    factors[factorCount++] = rest;
+  }
+  for (uint64_t candidate = 2; candidate < std::min<uint64_t>(prime, 1000); ++candidate) {
+    if (powerModuloPrime(candidate, prime - 1, prime) != 1) { //Fermat test fails
+      return 0;
+    }
+    bool isGenerator = true;
+    for (size_t i = 0; i < factorCount && isGenerator; ++i) {
+      isGenerator = powerModuloPrime(candidate, (prime - 1) / factors[i], prime) != 1;
+    }
+    if (isGenerator) {
+      return candidate;
+    }
+  }
+  return 0;
+}
+
+template<uint64_t Prime>
+class NumberTheoreticTransform { //transforms modulo a prime below 2^32, so every product fits in 64 bits
+  static_assert(Prime > 2 && (Prime >> 32) == 0, "transform prime must be odd and below 2^32");
+public:
+  static constexpr uint64_t kRoot = primitiveRoot(Prime); //zero if Prime is not prime
+  static constexpr size_t kMaxLength = kRoot == 0 ? 1 : size_t(1) << std::countr_zero(Prime - 1);
+
+  static void transform(std::vector<uint64_t>& values, bool inverse) { //in place, length is a power of two up to kMaxLength
+    const size_t length = values.size();
+    assert(length <= kMaxLength && "No root of unity of this order modulo the transform prime");
+    reorderBitReversed(values);
+    for (size_t blockLength = 2; blockLength <= length; blockLength <<= 1) {
+      const size_t half = blockLength >> 1;
+      uint64_t step = powerModuloPrime(kRoot, (Prime - 1) / blockLength, Prime);
+      if (inverse) {
+        step = powerModuloPrime(step, Prime - 2, Prime);
+      }
+      std::vector<uint64_t> roots(half);
+      roots[0] = 1;
+      for (size_t k = 1; k < half; ++k) {
+        roots[k] = roots[k - 1] * step % Prime;
+      }
+      for (size_t start = 0; start < length; start += blockLength) {
+        for (size_t k = 0; k < half; ++k) {
+          const uint64_t even = values[start + k];
+          const uint64_t odd = values[start + k + half] * roots[k] % Prime;
+          values[start + k] = even + odd >= Prime ? even + odd - Prime : even + odd;
+          values[start + k + half] = even >= odd ? even - odd : even + Prime - odd;
+        }
+      }
+    }
+    if (inverse) {
+      const uint64_t inverseLength = powerModuloPrime(length, Prime - 2, Prime);
+      for (uint64_t& value : values) {
+        value = value * inverseLength % Prime;
+      }
+    }
+  }
+
+  //inputs are reduced here; the result length rounded up to a power of two must not exceed kMaxLength
+  static std::vector<uint64_t> convolve(const std::vector<uint64_t>& lhs, const std::vector<uint64_t>& rhs) {
+    if (lhs.empty() || rhs.empty()) {
+      return {};
+    }
+    const size_t resultSize = lhs.size() + rhs.size() - 1;
+    const size_t length = transformLength(resultSize);
+    std::vector<uint64_t> left(length, 0);
+    std::vector<uint64_t> right(length, 0);
+    for (size_t i = 0; i < lhs.size(); ++i) {
+      left[i] = lhs[i] % Prime;
+    }
+    for (size_t i = 0; i < rhs.size(); ++i) {
+      right[i] = rhs[i] % Prime;
+    }
+    transform(left, false);
+    transform(right, false);
+    for (size_t i = 0; i < length; ++i) {
+      left[i] = left[i] * right[i] % Prime;
+    }
+    transform(left, true);
+    left.resize(resultSize);
+    return left;
+  }
+
+};
+
+constexpr uint64_t kFirstPrime = 998244353; //2^23 * 119 + 1
+constexpr uint64_t kSecondPrime = 167772161; //2^25 * 5 + 1
+constexpr uint64_t kThirdPrime = 469762049; //2^26 * 7 + 1
+
+//exact convolution of words below 2^32 through three transforms and Garner's reconstruction. Every result
+//is reduced modulo modulus, or returned exactly when modulus is zero (the true value must then be below 2^64).
+//Exact while the true values stay below kFirstPrime * kSecondPrime * kThirdPrime (about 7.9e25). Results longer
+//than the shortest transform allows (2^23 for kFirstPrime) are summed from convolutions of operand pieces
+inline std::vector<uint64_t> convolveModulo(const std::vector<uint64_t>& lhs, const std::vector<uint64_t>& rhs, uint64_t modulus) {
+  using First = NumberTheoreticTransform<kFirstPrime>;
+  using Second = NumberTheoreticTransform<kSecondPrime>;
+  using Third = NumberTheoreticTransform<kThirdPrime>;
+  if (lhs.empty() || rhs.empty()) {
+    return {};
+  }
+  if (transformLength(lhs.size() + rhs.size() - 1) > First::kMaxLength) {
+    constexpr size_t kPiece = First::kMaxLength / 2; //the product of two pieces has fewer than kMaxLength terms
+    std::vector<uint64_t> result(lhs.size() + rhs.size() - 1, 0);
+    for (size_t i = 0; i < lhs.size(); i += kPiece) {
+      const std::vector<uint64_t> left(lhs.begin() + static_cast<ptrdiff_t>(i), lhs.begin() + static_cast<ptrdiff_t>(std::min(lhs.size(), i + kPiece)));
+      for (size_t j = 0; j < rhs.size(); j += kPiece) {
+        const std::vector<uint64_t> right(rhs.begin() + static_cast<ptrdiff_t>(j), rhs.begin() + static_cast<ptrdiff_t>(std::min(rhs.size(), j + kPiece)));
+        const std::vector<uint64_t> part = convolveModulo(left, right, modulus);
+        for (size_t k = 0; k < part.size(); ++k) {
+          uint64_t& target = result[i + j + k];
+          target = modulus == 0 || part[k] < modulus - target ? target + part[k] : part[k] - (modulus - target);
+        }
+      }
+    }
+    return result;
+  }
+  const std::vector<uint64_t> first = First::convolve(lhs, rhs);
+  const std::vector<uint64_t> second = Second::convolve(lhs, rhs);
+  const std::vector<uint64_t> third = Third::convolve(lhs, rhs);
+
+  constexpr uint64_t kFirstInverse = powerModuloPrime(kFirstPrime, kSecondPrime - 2, kSecondPrime); //modulo kSecondPrime
+  constexpr uint64_t kFirstSecondInverse = powerModuloPrime(kFirstPrime % kThirdPrime * (kSecondPrime % kThirdPrime), kThirdPrime - 2, kThirdPrime);
+  const unsigned __int128 firstSecond = static_cast<unsigned __int128>(kFirstPrime) * kSecondPrime;
+
+  std::vector<uint64_t> result(first.size());
+  for (size_t i = 0; i < result.size(); ++i) { //x = a + kFirstPrime * b + kFirstPrime * kSecondPrime * c
+    const uint64_t a = first[i];
+    const uint64_t b = (second[i] + kSecondPrime - a % kSecondPrime) % kSecondPrime * kFirstInverse % kSecondPrime;
+    const uint64_t partial = (a + kFirstPrime % kThirdPrime * b) % kThirdPrime;
+    const uint64_t c = (third[i] + kThirdPrime - partial) % kThirdPrime * kFirstSecondInverse % kThirdPrime;
+    const unsigned __int128 value = a + static_cast<unsigned __int128>(kFirstPrime) * b + firstSecond * c;
+    result[i] = modulus == 0 ? static_cast<uint64_t>(value) : static_cast<uint64_t>(value % modulus);
+  }
+  return result;
+}
+
+}
@@ -87,6 +87,46 @@ void testBigIntegerIO() {
     assert(b.toString() == "-987654321");
 }
 
+void testBigIntegerBinaryIO() {
+    stringstream ss;
+    BigInteger a("-12345678901234567890123");
+    BigInteger zero;
+    a.writeBinary(ss);
+    zero.writeBinary(ss);
+    BigInteger b, c;
+    assert(BigInteger::readBinary(ss, b));
+    assert(BigInteger::readBinary(ss, c));
+    assert(a == b);
+    assert(c == 0);
+    assert(!BigInteger::readBinary(ss, b)); // поток закончился
+
+    // Запись из памяти: знак, число лимбов и лимбы по основанию 10^5 в little-endian
+    const unsigned char bytes[] = {1, 2, 0, 0, 0, 0x39, 0x30, 0, 0, 1, 0, 0, 0};
+    const unsigned char* cursor = bytes;
+    assert(BigInteger::readBinary(cursor, bytes + sizeof(bytes), b));
+    assert(b.toString() == "-112345");
+    assert(cursor == bytes + sizeof(bytes));
+
+    cursor = bytes;
+    assert(!BigInteger::readBinary(cursor, bytes + sizeof(bytes) - 1, b)); // обрезанная запись
+
+    // Испорченный заголовок: 2^32 - 1 лимбов, а данных почти нет — false без выделения гигабайтов
+    stringstream corrupt(string("\x00\xff\xff\xff\xff\x01\x00\x00\x00", 9));
+    assert(!BigInteger::readBinary(corrupt, b));
+}
+
+void testBigIntegerLargeMultiplication() {
+    // (10^n - 1)^2 = 9...980...01: сотни лимбов, умножение идёт через преобразование
+    const size_t n = 3000;
+    BigInteger nines(string(n, '9'));
+    BigInteger square = nines * nines;
+    assert(square.toString() == string(n - 1, '9') + "8" + string(n - 1, '0') + "1");
+
+    BigInteger negative = -nines;
+    assert(negative * nines == -square);
+    assert(square / nines == nines);
+}
+
 void testRationalCreation() {
     Rational a(5);       // 5/1
     Rational b(-3);      // -3/1
@@ -127,6 +167,30 @@ void testRationalComparison() {
     assert(a <= b);
 }
 
+void testRationalBinaryIO() {
+    stringstream ss;
+    Rational a(BigInteger(-22), BigInteger(7));
+    a.writeBinary(ss);
+    Rational b;
+    assert(Rational::readBinary(ss, b));
+    assert(a == b);
+    assert(b.toString() == "-22/7");
+
+    // Несокращённая дробь 2/4 читается как 1/2
+    stringstream unreduced;
+    BigInteger(2).writeBinary(unreduced);
+    BigInteger(4).writeBinary(unreduced);
+    assert(Rational::readBinary(unreduced, b));
+    assert(b == Rational(BigInteger(1), BigInteger(2)));
+    assert(b.toString() == "1/2");
+
+    // Нулевой знаменатель отвергается
+    stringstream zeroDenominator;
+    BigInteger(1).writeBinary(zeroDenominator);
+    BigInteger(0).writeBinary(zeroDenominator);
+    assert(!Rational::readBinary(zeroDenominator, b));
+}
+
 int main() {
     // Тесты BigInteger
     testBigIntegerCreation();
@@ -134,11 +198,14 @@ int main() {
     testBigIntegerComparison();
     testBigIntegerIncrementDecrement();
     testBigIntegerIO();
+    testBigIntegerBinaryIO();
+    testBigIntegerLargeMultiplication();
 
     // Тесты Rational
     testRationalCreation();
     testRationalArithmetic();
     testRationalComparison();
+    testRationalBinaryIO();
 
     cout << "All tests passed!" << endl;
     return 0;
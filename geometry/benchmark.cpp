@@ -0,0 +1,147 @@
+#include "geometry_io.h"
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <random>
+#include <string>
+#include <vector>
+
+//Times GeometryIO on random polygons against the plain iostream loops it replaces and prints one row per case:
+//seconds for the whole file and the speedup over the iostream reference where there is one.
+//Usage: ./benchmark [polygon count] [vertices per polygon] [scratch file prefix], e.g. ./benchmark 200000 8 /tmp/geometry
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+template<typename Function>
+double measureSeconds(Function function) { //one run: every case touches the whole file, repeats would only hit the page cache
+  const auto start = Clock::now();
+  function();
+  return secondsSince(start);
+}
+
+std::vector<Polygon> randomPolygons(size_t count, size_t vertices, std::mt19937& generator) {
+  std::uniform_real_distribution<double> coordinate(-1000, 1000);
+  std::vector<Polygon> polygons;
+  polygons.reserve(count);
+  for (size_t i = 0; i < count; ++i) {
+    std::vector<Point> points(vertices);
+    for (Point& point : points) {
+      point = Point(coordinate(generator), coordinate(generator));
+    }
+    polygons.emplace_back(std::move(points));
+  }
+  return polygons;
+}
+
+bool sameVertices(const std::vector<Polygon>& lhs, const std::vector<Polygon>& rhs) { //bit for bit, not up to kEps
+  if (lhs.size() != rhs.size()) {
+    return false;
+  }
+  for (size_t i = 0; i < lhs.size(); ++i) {
+    const std::vector<Point>& left = lhs[i].vertices();
+    const std::vector<Point>& right = rhs[i].vertices();
+    if (left.size() != right.size()) {
+      return false;
+    }
+    for (size_t j = 0; j < left.size(); ++j) {
+      if (left[j].x != right[j].x || left[j].y != right[j].y) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//reference loops: what reading and writing the text format looked like before GeometryIO
+void iostreamWrite(const std::string& path, const std::vector<Polygon>& polygons) {
+  std::ofstream out(path);
+  out << std::setprecision(17);
+  for (const Polygon& polygon : polygons) {
+    out << polygon.verticesCount() << std::endl;
+    for (const Point& point : polygon.vertices()) {
+      out << point.x << ' ' << point.y << std::endl;
+    }
+  }
+}
+
+std::vector<Polygon> iostreamRead(const std::string& path) {
+  std::ifstream in(path);
+  std::vector<Polygon> polygons;
+  size_t count = 0;
+  while (in >> count) {
+    std::vector<Point> points(count);
+    for (Point& point : points) {
+      in >> point.x >> point.y;
+    }
+    polygons.emplace_back(points);
+  }
+  return polygons;
+}
+
+void printHeader() {
+  std::cout << std::left << std::setw(26) << "case" << std::right << std::setw(12) << "time, s" << std::setw(14) << "iostream, s"
+            << std::setw(10) << "speedup" << std::setw(8) << "same" << '\n';
+}
+
+//referenceSeconds <= 0 means no reference; roundTrip is whether the polygons read back bit for bit
+void printRow(const std::string& name, double seconds, double referenceSeconds, bool roundTrip) {
+  std::cout << std::left << std::setw(26) << name << std::right << std::fixed << std::setprecision(3) << std::setw(12) << seconds;
+  if (referenceSeconds > 0) {
+    std::cout << std::setw(14) << referenceSeconds << std::setprecision(1) << std::setw(9) << referenceSeconds / seconds << 'x';
+  } else {
+    std::cout << std::setw(24) << "";
+  }
+  std::cout << std::setw(8) << (roundTrip ? "yes" : "no") << '\n';
+}
+
+}
+
+int main(int argc, char** argv) {
+  const size_t count = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 200000;
+  const size_t vertices = argc > 2 ? std::strtoull(argv[2], nullptr, 10) : 8;
+  const std::string prefix = argc > 3 ? argv[3] : "geometry_benchmark";
+  const std::string textPath = prefix + ".txt";
+  const std::string binaryPath = prefix + ".bin";
+  const std::string iostreamPath = prefix + "_iostream.txt";
+
+  std::mt19937 generator(2024);
+  const std::vector<Polygon> polygons = randomPolygons(count, vertices, generator);
+  std::cout << count << " polygons of " << vertices << " vertices\n";
+  printHeader();
+
+  const double iostreamWriteSeconds = measureSeconds([&] { iostreamWrite(iostreamPath, polygons); });
+  const double textWriteSeconds = measureSeconds([&] { GeometryIO::savePolygons<fType>(textPath, polygons, GeometryIO::Format::Text); });
+  const double binaryWriteSeconds = measureSeconds([&] { GeometryIO::savePolygons<fType>(binaryPath, polygons, GeometryIO::Format::Binary); });
+  printRow("text write", textWriteSeconds, iostreamWriteSeconds, true);
+  printRow("binary write", binaryWriteSeconds, iostreamWriteSeconds, true);
+
+  std::vector<Polygon> iostreamPolygons;
+  const double iostreamReadSeconds = measureSeconds([&] { iostreamPolygons = iostreamRead(iostreamPath); });
+  std::vector<Polygon> textPolygons;
+  const double textReadSeconds = measureSeconds([&] { GeometryIO::loadPolygons(textPath, textPolygons); });
+  std::vector<Polygon> streamPolygons;
+  const double streamReadSeconds = measureSeconds([&] {
+    std::ifstream in(textPath, std::ios::binary);
+    GeometryIO::ByteSource source(in);
+    GeometryIO::readPolygons(source, streamPolygons);
+  });
+  std::vector<Polygon> binaryPolygons;
+  const double binaryReadSeconds = measureSeconds([&] { GeometryIO::loadPolygons(binaryPath, binaryPolygons); });
+  printRow("text read (mmap)", textReadSeconds, iostreamReadSeconds, sameVertices(polygons, textPolygons));
+  printRow("text read (stream)", streamReadSeconds, iostreamReadSeconds, sameVertices(polygons, streamPolygons));
+  printRow("binary read (mmap)", binaryReadSeconds, iostreamReadSeconds, sameVertices(polygons, binaryPolygons));
+  printRow("iostream read", iostreamReadSeconds, 0, sameVertices(polygons, iostreamPolygons));
+
+  for (const std::string& path : {textPath, binaryPath, iostreamPath}) {
+    std::remove(path.c_str());
+  }
+  return 0;
+}
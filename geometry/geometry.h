@@ -1,26 +1,45 @@
 #pragma once
 
 #include <algorithm>
+#include <array>
+#include <atomic>
+#include <cassert>
 #include <cmath>
+#include <compare>
+#include <concepts>
+#include <cstdint>
 #include <functional>
+#include <limits>
+#include <map>
+#include <mutex>
 #include <optional>
-#include <tuple>
+#include <queue>
+#include <span>
 #include <sstream>
+#include <stdexcept>
+#include <tuple>
+#include <type_traits>
 #include <vector>
+#ifdef __AVX2__
+#include <immintrin.h>
+#endif
 
-using fType = double;
+using fType = double; //coordinate type behind the Point, Line, Polygon, ... aliases
 
 namespace MathFunc {
-  struct Vector {
-    fType x = 0;
-    fType y = 0;
-    Vector(fType x_, fType y_)
+  template<typename T>
+  struct BasicVector {
+    T x = 0;
+    T y = 0;
+    BasicVector(T x_, T y_)
     : x(x_)
     , y(y_)
     {}
-    Vector() = default;
+    BasicVector() = default;
   };
 
+  using Vector = BasicVector<fType>;
+
   template<typename T>
   int sign(T x) {
     if (x < 0) {
@@ -32,414 +51,2212 @@ namespace MathFunc {
     return 0;
   }
 
-  bool floatisEqual(fType lhs, fType rhs) {
+  inline bool floatisEqual(fType lhs, fType rhs) {
     constexpr fType kEps = 1e-9;
     return fabs(lhs - rhs) < kEps;
   }
+
+  //Booth's algorithm: start of the lexicographically least cyclic rotation in O(n) comparisons
+  template<typename T>
+  size_t leastRotation(const std::vector<T>& sequence) {
+    const size_t length = sequence.size();
+    std::vector<ptrdiff_t> failure(2 * length, -1);
+    size_t start = 0;
+    for (size_t j = 1; j < 2 * length; ++j) {
+      const T& current = sequence[j % length];
+      ptrdiff_t i = failure[j - start - 1];
+      while (i != -1 && !(current == sequence[(start + static_cast<size_t>(i) + 1) % length])) {
+        if (current < sequence[(start + static_cast<size_t>(i) + 1) % length]) {
+          start = j - static_cast<size_t>(i) - 1;
+        }
+        i = failure[static_cast<size_t>(i)];
+      }
+      if (i == -1 && !(current == sequence[start % length])) {
+        if (current < sequence[start % length]) {
+          start = j;
+        }
+        failure[j - start] = -1;
+      } else {
+        failure[j - start] = i + 1;
+      }
+    }
+    return length == 0 ? 0 : start % length;
+  }
+}
+
+//Shewchuk's adaptive precision predicates. The determinant is evaluated in plain double arithmetic first and its sign
+//accepted when it exceeds a forward error bound; only inconclusive (nearly degenerate) cases are recomputed exactly
+//with floating point expansions, sums of nonoverlapping doubles. The sign is always exact, and the common case costs a
+//few extra flops and one comparison. Assumes round-to-nearest IEEE doubles without overflow or underflow
+namespace Predicates {
+  using Expansion = std::vector<double>; //nonoverlapping components by increasing magnitude, zeros eliminated
+
+  constexpr double kEpsilon = std::numeric_limits<double>::epsilon() / 2; //2^-53, half an ulp of 1
+  constexpr double kOrientationBound = (3 + 16 * kEpsilon) * kEpsilon;
+  constexpr double kInCircleBound = (10 + 96 * kEpsilon) * kEpsilon;
+
+  inline void twoSum(double a, double b, double& sum, double& error) { //a + b == sum + error exactly
+    sum = a + b;
+    const double virtualB = sum - a;
+    const double virtualA = sum - virtualB;
+    error = (a - virtualA) + (b - virtualB);
+  }
+
+  inline void twoProduct(double a, double b, double& product, double& error) { //a * b == product + error exactly
+    product = a * b;
+    error = std::fma(a, b, -product);
+  }
+
+  inline Expansion difference(double a, double b) {
+    double sum = 0;
+    double error = 0;
+    twoSum(a, -b, sum, error);
+    Expansion result;
+    for (double component : {error, sum}) {
+      if (component != 0) {
+        result.push_back(component);
+      }
+    }
+    return result;
+  }
+
+  inline Expansion sum(const Expansion& lhs, const Expansion& rhs) { //merge by magnitude, then one pass of twoSum
+    Expansion merged(lhs.size() + rhs.size());
+    std::merge(lhs.begin(), lhs.end(), rhs.begin(), rhs.end(), merged.begin(), [](double a, double b) {
+      return std::abs(a) < std::abs(b);
+    });
+    Expansion result;
+    if (merged.empty()) {
+      return result;
+    }
+    double accumulated = merged[0];
+    for (size_t i = 1; i < merged.size(); ++i) {
+      double error = 0;
+      twoSum(accumulated, merged[i], accumulated, error);
+      if (error != 0) {
+        result.push_back(error);
+      }
+    }
+    if (accumulated != 0) {
+      result.push_back(accumulated);
+    }
+    return result;
+  }
+
+  inline Expansion scale(const Expansion& expansion, double factor) {
+    Expansion result;
+    if (expansion.empty() || factor == 0) {
+      return result;
+    }
+    double accumulated = 0;
+    double error = 0;
+    twoProduct(expansion[0], factor, accumulated, error);
+    if (error != 0) {
+      result.push_back(error);
+    }
+    for (size_t i = 1; i < expansion.size(); ++i) {
+      double high = 0;
+      double low = 0;
+      twoProduct(expansion[i], factor, high, low);
+      double partial = 0;
+      twoSum(accumulated, low, partial, error);
+      if (error != 0) {
+        result.push_back(error);
+      }
+      twoSum(high, partial, accumulated, error);
+      if (error != 0) {
+        result.push_back(error);
+      }
+    }
+    if (accumulated != 0) {
+      result.push_back(accumulated);
+    }
+    return result;
+  }
+
+  inline Expansion product(const Expansion& lhs, const Expansion& rhs) {
+    Expansion result;
+    for (double component : rhs) {
+      result = sum(result, scale(lhs, component));
+    }
+    return result;
+  }
+
+  inline Expansion negated(Expansion expansion) {
+    for (double& component : expansion) {
+      component = -component;
+    }
+    return expansion;
+  }
+
+  inline int sign(const Expansion& expansion) { //the largest component decides
+    return expansion.empty() ? 0 : MathFunc::sign(expansion.back());
+  }
+
+  inline int exactOrientation(double ax, double ay, double bx, double by, double cx, double cy) {
+    const Expansion left = product(difference(ax, cx), difference(by, cy));
+    const Expansion right = product(difference(ay, cy), difference(bx, cx));
+    return sign(sum(left, negated(right)));
+  }
+
+  //sign of (a - c) x (b - c): positive if a, b, c turn counterclockwise, zero if collinear
+  inline int orientation(double ax, double ay, double bx, double by, double cx, double cy) {
+    const double left = (ax - cx) * (by - cy);
+    const double right = (ay - cy) * (bx - cx);
+    const double determinant = left - right;
+    if ((left > 0 && right <= 0) || (left < 0 && right >= 0) || left == 0) { //no cancellation
+      return MathFunc::sign(determinant);
+    }
+    const double bound = kOrientationBound * std::abs(left + right);
+    if (determinant >= bound || -determinant >= bound) {
+      return MathFunc::sign(determinant);
+    }
+    return exactOrientation(ax, ay, bx, by, cx, cy);
+  }
+
+  inline int exactInCircle(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy) {
+    const Expansion adx = difference(ax, dx);
+    const Expansion ady = difference(ay, dy);
+    const Expansion bdx = difference(bx, dx);
+    const Expansion bdy = difference(by, dy);
+    const Expansion cdx = difference(cx, dx);
+    const Expansion cdy = difference(cy, dy);
+    auto lift = [](const Expansion& x, const Expansion& y) {
+      return sum(product(x, x), product(y, y));
+    };
+    auto cross = [](const Expansion& x1, const Expansion& y1, const Expansion& x2, const Expansion& y2) {
+      return sum(product(x1, y2), negated(product(x2, y1)));
+    };
+    const Expansion aTerm = product(lift(adx, ady), cross(bdx, bdy, cdx, cdy));
+    const Expansion bTerm = product(lift(bdx, bdy), cross(cdx, cdy, adx, ady));
+    const Expansion cTerm = product(lift(cdx, cdy), cross(adx, ady, bdx, bdy));
+    return sign(sum(sum(aTerm, bTerm), cTerm));
+  }
+
+  //positive if d lies inside the circle through a, b, c given counterclockwise, zero if the four are cocircular
+  inline int inCircle(double ax, double ay, double bx, double by, double cx, double cy, double dx, double dy) {
+    const double adx = ax - dx;
+    const double ady = ay - dy;
+    const double bdx = bx - dx;
+    const double bdy = by - dy;
+    const double cdx = cx - dx;
+    const double cdy = cy - dy;
+    const double bdxcdy = bdx * cdy;
+    const double cdxbdy = cdx * bdy;
+    const double cdxady = cdx * ady;
+    const double adxcdy = adx * cdy;
+    const double adxbdy = adx * bdy;
+    const double bdxady = bdx * ady;
+    const double aLift = adx * adx + ady * ady;
+    const double bLift = bdx * bdx + bdy * bdy;
+    const double cLift = cdx * cdx + cdy * cdy;
+    const double determinant = aLift * (bdxcdy - cdxbdy) + bLift * (cdxady - adxcdy) + cLift * (adxbdy - bdxady);
+    const double permanent = (std::abs(bdxcdy) + std::abs(cdxbdy)) * aLift + (std::abs(cdxady) + std::abs(adxcdy)) * bLift
+                           + (std::abs(adxbdy) + std::abs(bdxady)) * cLift;
+    const double bound = kInCircleBound * permanent;
+    if (determinant > bound || -determinant > bound) {
+      return MathFunc::sign(determinant);
+    }
+    return exactInCircle(ax, ay, bx, by, cx, cy, dx, dy);
+  }
 }
 
-class Point {
+//Per coordinate type policy, chosen at compile time. Real carries lengths, angles and other irrational results; Scalar
+//carries affine coefficients and interpolation ratios, so it stays exact wherever the coordinate type is.
+//The primary template covers exact number types such as Rational: equality and orientation are exact, and metric
+//results are computed in double. Such a type needs construction from int, field arithmetic, ordering and explicit
+//conversion to double
+template<typename T>
+struct CoordinateTraits {
+  using Real = double;
+  using Scalar = T;
+
+  static constexpr bool kExact = true;
+
+  static bool isEqual(const T& lhs, const T& rhs) {
+    return lhs == rhs;
+  }
+
+  static int orientation(const T& ax, const T& ay, const T& bx, const T& by, const T& cx, const T& cy) {
+    return MathFunc::sign((bx - ax) * (cy - by) - (by - ay) * (cx - bx));
+  }
+
+  static Real toReal(const T& value) {
+    T copy = value; //conversions of number classes such as Rational need not be const
+    return static_cast<Real>(copy);
+  }
+
+  static T fromReal(Real value) { //exact: a double is a 53 bit integer times a power of two
+    int exponent = 0;
+    const Real mantissa = std::frexp(value, &exponent);
+    const int64_t digits = static_cast<int64_t>(std::ldexp(mantissa, 53));
+    const T result = T(static_cast<int>(digits >> 26)) * T(1 << 26) + T(static_cast<int>(digits & ((1 << 26) - 1)));
+    exponent -= 53;
+    T power = T(1);
+    T base = T(2);
+    for (int rest = std::abs(exponent); rest > 0; rest >>= 1) {
+      if (rest & 1) {
+        power = power * base;
+      }
+      base = base * base;
+    }
+    return exponent >= 0 ? result * power : result / power;
+  }
+
+  static T toScalar(const T& value) {
+    return value;
+  }
+
+  static T fromScalar(const Scalar& value) {
+    return value;
+  }
+
+  static Scalar scalarFromReal(Real value) {
+    return fromReal(value);
+  }
+
+  static Real scalarToReal(const Scalar& value) {
+    return toReal(value);
+  }
+
+  static Scalar ratio(const T& numerator, const T& denominator) {
+    return numerator / denominator;
+  }
+};
+
+template<std::floating_point T>
+struct CoordinateTraits<T> {
+  using Real = T;
+  using Scalar = T;
+
+  static constexpr bool kExact = false;
+  static constexpr T kEpsilon = std::is_same_v<T, float> ? T(1e-4) : T(1e-9);
+
+  static bool isEqual(T lhs, T rhs) {
+    return std::abs(lhs - rhs) < kEpsilon;
+  }
+
+  //exact by default: floats widen to doubles exactly, and the adaptive predicate settles most double cases in its filter.
+  //GEOMETRY_FAST_PREDICATES trades exactness for speed on doubles; the two rounded products are compared rather than
+  //subtracted, so the answer does not depend on whether the compiler contracts into FMA
+  static int orientation(T ax, T ay, T bx, T by, T cx, T cy) {
+#ifdef GEOMETRY_FAST_PREDICATES
+    if constexpr (std::is_same_v<T, double>) {
+      const T left = (bx - ax) * (cy - by);
+      const T right = (by - ay) * (cx - bx);
+      return (left > right) - (left < right);
+    }
+#endif
+    return Predicates::orientation(ax, ay, bx, by, cx, cy);
+  }
+
+  static T toReal(T value) {
+    return value;
+  }
+
+  static T fromReal(T value) {
+    return value;
+  }
+
+  static T toScalar(T value) {
+    return value;
+  }
+
+  static T fromScalar(T value) {
+    return value;
+  }
+
+  static T scalarFromReal(T value) {
+    return value;
+  }
+
+  static T scalarToReal(T value) {
+    return value;
+  }
+
+  static T ratio(T numerator, T denominator) {
+    return numerator / denominator;
+  }
+};
+
+template<std::integral T>
+struct CoordinateTraits<T> { //integer grids: exact predicates, derived points are rounded to the nearest grid point
+  using Real = double;
+  using Scalar = double;
+
+  static constexpr bool kExact = true;
+
+  static bool isEqual(T lhs, T rhs) {
+    return lhs == rhs;
+  }
+
+  static int orientation(T ax, T ay, T bx, T by, T cx, T cy) { //exact while coordinates stay below 2^62 in magnitude
+    using Wide = __int128;
+    return MathFunc::sign((Wide(bx) - ax) * (Wide(cy) - by) - (Wide(by) - ay) * (Wide(cx) - bx));
+  }
+
+  static double toReal(T value) {
+    return static_cast<double>(value);
+  }
+
+  static T fromReal(double value) {
+    return static_cast<T>(std::llround(value));
+  }
+
+  static double toScalar(T value) {
+    return static_cast<double>(value);
+  }
+
+  static T fromScalar(double value) {
+    return fromReal(value);
+  }
+
+  static double scalarFromReal(double value) {
+    return value;
+  }
+
+  static double scalarToReal(double value) {
+    return value;
+  }
+
+  static double ratio(T numerator, T denominator) {
+    return static_cast<double>(numerator) / static_cast<double>(denominator);
+  }
+};
+
+template<typename T>
+class BasicPoint {
 public:
-  fType x = 0;
-  fType y = 0;
+  using Traits = CoordinateTraits<T>;
+  using Real = typename Traits::Real;
+  using Vector = MathFunc::BasicVector<T>;
 
-  Point(fType x_, fType y_)
+  T x = 0;
+  T y = 0;
+
+  BasicPoint(T x_, T y_)
   : x(x_)
   , y(y_)
   {}
 
-  Point() = default;
+  BasicPoint() = default;
 
-  operator MathFunc::Vector() const {
-    return MathFunc::Vector(x, y);
+  operator Vector() const {
+    return Vector(x, y);
   }
 
-  Point(const MathFunc::Vector& vector)
+  BasicPoint(const Vector& vector)
   : x(vector.x)
   , y(vector.y)
   {}
 
-  Point rotate(fType angle) const;
+  static BasicPoint fromReal(Real x, Real y) {
+    return BasicPoint(Traits::fromReal(x), Traits::fromReal(y));
+  }
+
+  BasicPoint rotate(Real angle) const;
 
-  Point rotate(const Point& point, fType angle) const;
+  BasicPoint rotate(const BasicPoint& point, Real angle) const;
 
-  Point reflect( const Point& point) const;
+  BasicPoint reflect( const BasicPoint& point) const;
 
-  Point scale(const Point& point, fType scale) const;
+  BasicPoint scale(const BasicPoint& point, Real scale) const;
 
-  Point perpendicular() const;
+  BasicPoint perpendicular() const;
 
-  fType dotProduct(const Point& another) const;
+  T dotProduct(const BasicPoint& another) const;
 
-  fType crossProduct(const Point& another) const;
+  T crossProduct(const BasicPoint& another) const;
 
-  fType length2() const;
+  T length2() const;
 
-  fType length() const;
+  Real length() const;
 
-  Point bisector(Point rhs) const;
+  BasicPoint bisector(BasicPoint rhs) const;
 
-  fType angleBetweenTwoVectors(const Point& another) const;
+  Real angleBetweenTwoVectors(const BasicPoint& another) const;
 };
 
-Point operator+(const Point& lhs, const Point& rhs) {
-  return Point(lhs.x + rhs.x, lhs.y + rhs.y);
+using Point = BasicPoint<fType>;
+
+template<typename T>
+BasicPoint<T> operator+(const BasicPoint<T>& lhs, const BasicPoint<T>& rhs) {
+  return BasicPoint<T>(lhs.x + rhs.x, lhs.y + rhs.y);
 }
 
-Point operator-(const Point& lhs, const Point& rhs) {
-  return Point(lhs.x - rhs.x, lhs.y - rhs.y);
+template<typename T>
+BasicPoint<T> operator-(const BasicPoint<T>& lhs, const BasicPoint<T>& rhs) {
+  return BasicPoint<T>(lhs.x - rhs.x, lhs.y - rhs.y);
 }
 
-Point operator*(const Point& point, fType scalar) {
-  return Point(point.x * scalar, point.y * scalar);
+template<typename T>
+BasicPoint<T> operator*(const BasicPoint<T>& point, std::type_identity_t<T> scalar) {
+  return BasicPoint<T>(point.x * scalar, point.y * scalar);
 }
 
-Point operator/(const Point& point, fType scalar) {
-  return Point(point.x / scalar, point.y / scalar);
+template<typename T>
+BasicPoint<T> operator/(const BasicPoint<T>& point, std::type_identity_t<T> scalar) {
+  return BasicPoint<T>(point.x / scalar, point.y / scalar);
 }
 
-bool operator==(const Point& lhs, const Point& rhs) {
-  return MathFunc::floatisEqual(lhs.x, rhs.x) && MathFunc::floatisEqual(lhs.y, rhs.y);
+template<typename T>
+bool operator==(const BasicPoint<T>& lhs, const BasicPoint<T>& rhs) {
+  return CoordinateTraits<T>::isEqual(lhs.x, rhs.x) && CoordinateTraits<T>::isEqual(lhs.y, rhs.y);
 }
 
-Point Point::rotate(fType angle) const {
-  return Point(x * cos(angle) - y * sin(angle), x * sin(angle) + y * cos(angle));
+template<typename T>
+BasicPoint<T> BasicPoint<T>::rotate(Real angle) const {
+  const Real realX = Traits::toReal(x);
+  const Real realY = Traits::toReal(y);
+  return fromReal(realX * cos(angle) - realY * sin(angle), realX * sin(angle) + realY * cos(angle));
 }
 
-Point Point::rotate(const Point& point, fType angle) const {
+template<typename T>
+BasicPoint<T> BasicPoint<T>::rotate(const BasicPoint& point, Real angle) const {
   return *this + (point - *this).rotate(angle);
 }
 
-Point Point::reflect(const Point& point) const {
+template<typename T>
+BasicPoint<T> BasicPoint<T>::reflect(const BasicPoint& point) const {
   return *this + (*this - point);
 }
 
-Point Point::scale(const Point& point, fType scale) const {
-  return *this + (point - *this) * scale;
+template<typename T>
+BasicPoint<T> BasicPoint<T>::scale(const BasicPoint& point, Real scale) const {
+  const BasicPoint offset = point - *this;
+  return *this + fromReal(Traits::toReal(offset.x) * scale, Traits::toReal(offset.y) * scale);
 }
 
-Point Point::perpendicular() const {
-  return Point(-y, x);
+template<typename T>
+BasicPoint<T> BasicPoint<T>::perpendicular() const {
+  return BasicPoint(-y, x);
 }
 
-fType Point::dotProduct(const Point& another) const {
+template<typename T>
+T BasicPoint<T>::dotProduct(const BasicPoint& another) const {
   return x * another.x + y * another.y;
 }
 
-fType Point::crossProduct(const Point& another) const {
+template<typename T>
+T BasicPoint<T>::crossProduct(const BasicPoint& another) const {
   return x * another.y - y * another.x;
 }
 
-fType Point::length2() const {
+template<typename T>
+T BasicPoint<T>::length2() const {
   return dotProduct(*this);
 }
 
-fType Point::length() const {
-  return std::sqrt(length2());
+template<typename T>
+typename BasicPoint<T>::Real BasicPoint<T>::length() const {
+  return std::sqrt(Traits::toReal(length2()));
+}
+
+template<typename T>
+BasicPoint<T> BasicPoint<T>::bisector(BasicPoint rhs) const {
+  const Real lhsLength = length();
+  const Real rhsLength = rhs.length();
+  return fromReal(Traits::toReal(x) / lhsLength + Traits::toReal(rhs.x) / rhsLength,
+                  Traits::toReal(y) / lhsLength + Traits::toReal(rhs.y) / rhsLength);
 }
 
-Point Point::bisector(Point rhs) const {
-  Point lhs = *this;
-  lhs = lhs / lhs.length();
-  rhs = rhs / rhs.length();
-  return Point(lhs.x + rhs.x, lhs.y + rhs.y);
+template<typename T>
+typename BasicPoint<T>::Real BasicPoint<T>::angleBetweenTwoVectors(const BasicPoint& another) const {
+  return atan2(Traits::toReal(crossProduct(another)), Traits::toReal(dotProduct(another)));
+}
+
+namespace Predicates {
+  inline int orientation(const Point& a, const Point& b, const Point& c) {
+    return orientation(a.x, a.y, b.x, b.y, c.x, c.y);
+  }
+
+  inline int inCircle(const Point& a, const Point& b, const Point& c, const Point& d) {
+    return inCircle(a.x, a.y, b.x, b.y, c.x, c.y, d.x, d.y);
+  }
 }
 
-fType Point::angleBetweenTwoVectors(const Point& another) const {
-  return atan2(crossProduct(another), dotProduct(another));
+//the turn a -> b -> c: 1 counterclockwise, -1 clockwise, 0 collinear. Every orientation test of Polygon, PreparedPolygon,
+//convexHull and PolygonClipper goes through here and CoordinateTraits: exact for every coordinate type, unless
+//GEOMETRY_FAST_PREDICATES is defined before including the header to use rounded products for double
+template<typename T>
+int orientation(const BasicPoint<T>& a, const BasicPoint<T>& b, const BasicPoint<T>& c) {
+  return CoordinateTraits<T>::orientation(a.x, a.y, b.x, b.y, c.x, c.y);
 }
 
-class Line {
+template<typename T>
+class BasicLine {
 public:
-  Line (const Point& point1, const Point& point2) {
+  using Point = BasicPoint<T>;
+  using Traits = CoordinateTraits<T>;
+  using Vector = MathFunc::BasicVector<T>;
+
+  BasicLine (const Point& point1, const Point& point2) {
     cA_ = point1.y - point2.y;
     cB_ = point2.x - point1.x;
     cC_ = -(cA_ * point1.x + cB_ * point1.y);
   }
 
-  Line (fType k, fType b)
-  : Line(Point(0, b), Point(1, k + b))
+  BasicLine (T k, T b)
+  : BasicLine(Point(0, b), Point(1, k + b))
   {}
 
-  Line (const Point& point, fType k)
-  : Line(point, Point(point.x + 1, point.y + k))
+  BasicLine (const Point& point, T k)
+  : BasicLine(point, Point(point.x + 1, point.y + k))
   {}
 
-  Line (const Point& p, const MathFunc::Vector& v)
+  BasicLine (const Point& p, const Vector& v)
     : cA_(-v.y)
     , cB_(v.x)
     , cC_(-(cA_ * p.x + cB_ * p.y))
   {}
 
-  std::tuple<fType, fType, fType> getCoefficients() const {
+  std::tuple<T, T, T> getCoefficients() const {
     return std::make_tuple(cA_, cB_, cC_);
   }
 
-  Point intersection (const Line& another) const {
+  Point intersection (const BasicLine& another) const { //rounded to the grid for integer coordinates
     auto [a1, b1, c1] = another.getCoefficients();
-    return Point(-(c1 * cB_ - cC_ * b1) / (a1 * cB_ - cA_ * b1), -(a1 * cC_ - cA_ * c1) / (a1 * cB_ - cA_ * b1));
+    const T denominator = a1 * cB_ - cA_ * b1;
+    return Point(Traits::fromScalar(Traits::ratio(-(c1 * cB_ - cC_ * b1), denominator)),
+                 Traits::fromScalar(Traits::ratio(-(a1 * cC_ - cA_ * c1), denominator)));
   }
 
   Point reflect(const Point& point) const {
-    MathFunc::Vector v(cA_, cB_);
-    return point + (intersection(Line(point, v)) - point) * 2.0;
+    Vector v(cA_, cB_);
+    return point + (intersection(BasicLine(point, v)) - point) * T(2);
   }
 
 protected:
-  fType cA_;
-  fType cB_;
-  fType cC_;
+  T cA_;
+  T cB_;
+  T cC_;
 };
 
-bool operator==(const Line& line1, const Line& line2) {
+using Line = BasicLine<fType>;
+
+template<typename T>
+bool operator==(const BasicLine<T>& line1, const BasicLine<T>& line2) {
   auto [cA1, cB1, cC1] = line1.getCoefficients();
   auto [cA2, cB2, cC2] = line2.getCoefficients();
-  return MathFunc::floatisEqual(cA1 * cB2, cA2 * cB1)
-      && MathFunc::floatisEqual(cC1 * cB2, cC2 * cB1)
-      && MathFunc::floatisEqual(cC1 * cA2, cC2 * cA1);
+  return CoordinateTraits<T>::isEqual(cA1 * cB2, cA2 * cB1)
+      && CoordinateTraits<T>::isEqual(cC1 * cB2, cC2 * cB1)
+      && CoordinateTraits<T>::isEqual(cC1 * cA2, cC2 * cA1);
 }
 
-std::ostream& operator << (std::ostream& os, const Line& line) {
+template<typename T>
+std::ostream& operator << (std::ostream& os, const BasicLine<T>& line) {
   auto [a, b, c] = line.getCoefficients();
-  os << a << ' ' << b << " " << c << std::endl;
+  os << a << ' ' << b << " " << c << '\n'; //no flush per line, the caller decides when
   return os;
 }
 
-class Shape {
+//p -> (xx * p.x + xy * p.y + x0, yx * p.x + yy * p.y + y0); coefficients are Scalar, so integer points may be scaled
+//by fractions and are rounded back to the grid
+template<typename T>
+class BasicAffineTransform {
 public:
-  virtual fType perimeter() const  = 0;
+  using Point = BasicPoint<T>;
+  using Traits = CoordinateTraits<T>;
+  using Real = typename Traits::Real;
+  using Scalar = typename Traits::Scalar;
+
+  BasicAffineTransform() = default;
+
+  BasicAffineTransform(Scalar xx, Scalar xy, Scalar x0, Scalar yx, Scalar yy, Scalar y0)
+  : xx_(xx)
+  , xy_(xy)
+  , x0_(x0)
+  , yx_(yx)
+  , yy_(yy)
+  , y0_(y0)
+  {}
+
+  static BasicAffineTransform translation(const Point& shift) {
+    return BasicAffineTransform(1, 0, Traits::toScalar(shift.x), 0, 1, Traits::toScalar(shift.y));
+  }
+
+  static BasicAffineTransform rotation(const Point& center, Real angle) { //counterclockwise, angle in radians
+    const Scalar cosine = Traits::scalarFromReal(cos(angle));
+    const Scalar sine = Traits::scalarFromReal(sin(angle));
+    const Scalar centerX = Traits::toScalar(center.x);
+    const Scalar centerY = Traits::toScalar(center.y);
+    return BasicAffineTransform(cosine, -sine, centerX - cosine * centerX + sine * centerY,
+                                sine, cosine, centerY - sine * centerX - cosine * centerY);
+  }
 
-  virtual fType area() const  = 0;
+  static BasicAffineTransform reflection(const Point& center) {
+    return BasicAffineTransform(-1, 0, 2 * Traits::toScalar(center.x), 0, -1, 2 * Traits::toScalar(center.y));
+  }
+
+  static BasicAffineTransform reflection(const BasicLine<T>& axis) { //p - 2 * (Ax + By + C) / (A^2 + B^2) * (A, B)
+    auto [lineA, lineB, lineC] = axis.getCoefficients();
+    const Scalar a = Traits::toScalar(lineA);
+    const Scalar b = Traits::toScalar(lineB);
+    const Scalar c = Traits::toScalar(lineC);
+    const Scalar factor = Scalar(-2) / (a * a + b * b);
+    return BasicAffineTransform(1 + factor * a * a, factor * a * b, factor * a * c,
+                                factor * a * b, 1 + factor * b * b, factor * b * c);
+  }
 
-  virtual bool isCongruentTo(const Shape& another) const = 0;
+  static BasicAffineTransform scaling(const Point& center, Scalar coefficient) {
+    return BasicAffineTransform(coefficient, 0, Traits::toScalar(center.x) * (1 - coefficient),
+                                0, coefficient, Traits::toScalar(center.y) * (1 - coefficient));
+  }
 
-  virtual bool isSimilarTo(const Shape& another) const = 0;
+  Point apply(const Point& point) const {
+    const Scalar x = Traits::toScalar(point.x);
+    const Scalar y = Traits::toScalar(point.y);
+    return Point(Traits::fromScalar(xx_ * x + xy_ * y + x0_), Traits::fromScalar(yx_ * x + yy_ * y + y0_));
+  }
 
-  virtual bool containsPoint(const Point& point) = 0;
+  void apply(std::span<Point> points) const { //in place, one pass
+    for (Point& point : points) {
+      point = apply(point);
+    }
+  }
 
-  virtual void rotate(const Point& center, fType angle) = 0;
+  std::tuple<Scalar, Scalar, Scalar, Scalar, Scalar, Scalar> getCoefficients() const {
+    return std::make_tuple(xx_, xy_, x0_, yx_, yy_, y0_);
+  }
 
-  virtual void reflect(const Point& center) = 0;
+  Scalar determinant() const {
+    return xx_ * yy_ - xy_ * yx_;
+  }
 
-  virtual void reflect(const Line& axis) = 0;
+  bool isIdentity() const {
+    return xx_ == 1 && xy_ == 0 && x0_ == 0 && yx_ == 0 && yy_ == 1 && y0_ == 0;
+  }
 
-  virtual void scale(const Point& center, fType coefficient) = 0;
+  bool isSimilarity() const { //rotation, reflection and uniform scaling keep circles circles
+    using ScalarTraits = CoordinateTraits<Scalar>;
+    return (ScalarTraits::isEqual(xx_, yy_) && ScalarTraits::isEqual(xy_, -yx_))
+        || (ScalarTraits::isEqual(xx_, -yy_) && ScalarTraits::isEqual(xy_, yx_));
+  }
 
-  virtual ~Shape() = default;
+  Real similarityRatio() const {
+    return std::sqrt(std::abs(Traits::scalarToReal(determinant())));
+  }
 
-  bool operator==(const Shape& rhs) const {
-    return isEqual(rhs);
+  friend BasicAffineTransform operator*(const BasicAffineTransform& lhs, const BasicAffineTransform& rhs) { //rhs first, then lhs
+    return BasicAffineTransform(lhs.xx_ * rhs.xx_ + lhs.xy_ * rhs.yx_, lhs.xx_ * rhs.xy_ + lhs.xy_ * rhs.yy_, lhs.xx_ * rhs.x0_ + lhs.xy_ * rhs.y0_ + lhs.x0_,
+                                lhs.yx_ * rhs.xx_ + lhs.yy_ * rhs.yx_, lhs.yx_ * rhs.xy_ + lhs.yy_ * rhs.yy_, lhs.yx_ * rhs.x0_ + lhs.yy_ * rhs.y0_ + lhs.y0_);
   }
 
-protected:
-  virtual bool isEqual(const Shape& another) const = 0;
+private:
+  Scalar xx_ = 1;
+  Scalar xy_ = 0;
+  Scalar x0_ = 0;
+  Scalar yx_ = 0;
+  Scalar yy_ = 1;
+  Scalar y0_ = 0;
 };
 
-class Polygon : public Shape {
-public:
-  Polygon() = default;
+using AffineTransform = BasicAffineTransform<fType>;
 
-  Polygon(const std::vector<Point>& points_)
-  : vertices_(points_)
-  {}
+template<typename T>
+struct BasicBoundingBox { //axis-aligned; the default box is inverted, that is empty, and contains nothing
+  using Point = BasicPoint<T>;
+  using Real = typename CoordinateTraits<T>::Real;
 
-  Polygon(const std::initializer_list<Point>& points_)
-  : vertices_(points_)
-  {}
+  Point min = Point(1, 1);
+  Point max = Point(0, 0);
 
-  template<typename ...Pts>
-  explicit Polygon(const Pts&... pts)
-  : vertices_({pts...})
-  {}
+  bool isEmpty() const {
+    return min.x > max.x || min.y > max.y;
+  }
 
-  std::vector<Point>getVertices() const {
-    return vertices_;
+  void extend(const Point& point) {
+    if (isEmpty()) {
+      min = max = point;
+      return;
+    }
+    min = Point(std::min(min.x, point.x), std::min(min.y, point.y));
+    max = Point(std::max(max.x, point.x), std::max(max.y, point.y));
   }
 
-  size_t verticesCount() const {
-    return vertices_.size();
+  bool contains(const Point& point) const {
+    return min.x <= point.x && point.x <= max.x && min.y <= point.y && point.y <= max.y;
   }
 
-  bool isConvex() const {
-    bool wasNeg = false;
-    bool wasPos = false;
-    for (size_t i = 0; i < vertices_.size(); ++i) {
-      size_t j = (i + 1) % vertices_.size();
-      size_t k = (i + 2) % vertices_.size();
-      int result = MathFunc::sign((vertices_[j] - vertices_[i]).crossProduct(vertices_[k] - vertices_[j]));
-      if (result == -1) {
-        wasNeg = true;
-      } else if (result == 1) {
-        wasPos = true;
-      }
+  void extend(const BasicBoundingBox& another) {
+    if (another.isEmpty()) {
+      return;
     }
-    return !(wasNeg && wasPos);
+    if (isEmpty()) {
+      *this = another;
+      return;
+    }
+    min = Point(std::min(min.x, another.min.x), std::min(min.y, another.min.y));
+    max = Point(std::max(max.x, another.max.x), std::max(max.y, another.max.y));
   }
 
-  fType perimeter() const override {
-   fType result = 0;
-    for (size_t i = 0; i < vertices_.size(); ++i) {
-      result += (vertices_[(i + 1) % vertices_.size()] - vertices_[i]).length();
-    }
-    return result;
+  bool contains(const BasicBoundingBox& another) const {
+    return !isEmpty() && min.x <= another.min.x && another.max.x <= max.x && min.y <= another.min.y && another.max.y <= max.y;
   }
 
-  fType area() const override {
-    fType result = 0;
-    for (size_t i = 1; i + 1 < vertices_.size(); ++i) {
-      result += (vertices_[i] - vertices_[0]).crossProduct(vertices_[i + 1] - vertices_[0]);
-    }
-    result /= 2.0;
-    return fabs(result);
+  bool intersects(const BasicBoundingBox& another) const {
+    return !isEmpty() && !another.isEmpty()
+        && min.x <= another.max.x && another.min.x <= max.x && min.y <= another.max.y && another.min.y <= max.y;
   }
 
-  bool isCongruentTo(const Shape& another) const override {
-    auto result = getSimilarityСoefficient(another);
-    if (result) {
-      return MathFunc::floatisEqual(*result, 1);
-    }
-    return false;
+  Real area() const {
+    return isEmpty() ? 0 : CoordinateTraits<T>::toReal((max.x - min.x) * (max.y - min.y));
   }
 
-  bool isSimilarTo(const Shape& another) const override {
-    return getSimilarityСoefficient(another) != std::nullopt;
+  Point center() const {
+    return (min + max) / T(2);
   }
 
-  bool isEqual(const Shape& another) const override {
-    const Polygon* anotherPointer = dynamic_cast<const Polygon*>(&another);
-    if (anotherPointer == nullptr) {
-      return false;
+  Real distance2(const Point& point) const { //squared distance from the point to the box, zero inside
+    if (isEmpty()) {
+      return std::numeric_limits<Real>::infinity();
     }
+    const Real dx = CoordinateTraits<T>::toReal(std::max({min.x - point.x, T(0), point.x - max.x}));
+    const Real dy = CoordinateTraits<T>::toReal(std::max({min.y - point.y, T(0), point.y - max.y}));
+    return dx * dx + dy * dy;
+  }
+};
 
-    std::vector<Point> anotherVertices = anotherPointer->getVertices();
-    if (anotherVertices.size() != vertices_.size()) {
-      return false;
+using BoundingBox = BasicBoundingBox<fType>;
+
+//structure-of-arrays vertices of a closed polygon: x and y coordinates in separate arrays, so the bulk kernels
+//below process four vertices per AVX2 instruction instead of one interleaved Point at a time
+template<typename T>
+class BasicVertexArray {
+public:
+  using Point = BasicPoint<T>;
+  using Traits = CoordinateTraits<T>;
+  using Real = typename Traits::Real;
+
+  BasicVertexArray() = default;
+
+  explicit BasicVertexArray(std::span<const Point> points) {
+    xs_.reserve(points.size());
+    ys_.reserve(points.size());
+    for (const Point& point : points) {
+      append(point);
     }
+  }
 
-    auto isEqual = [&](const std::vector<Point>& anotherVertices) {
-      const int numberOfVertices = vertices_.size();
-      for (int shift = 0; shift <= numberOfVertices; ++shift) {
-        bool ok = true;
-        for (int i = 0; i < numberOfVertices && ok; ++i) {
-          ok &= vertices_[i] == anotherVertices[(shift + i) % numberOfVertices];
-        }
-        if (ok) {
-          return true;
-        }
-      }
-      return false;
-    };
+  size_t size() const {
+    return xs_.size();
+  }
 
-    if (!isEqual(anotherVertices)) {
-      reverse(anotherVertices.begin(), anotherVertices.end());
-      return isEqual(anotherVertices);
+  void reserve(size_t capacity) {
+    xs_.reserve(capacity);
+    ys_.reserve(capacity);
+  }
+
+  void append(const Point& point) {
+    xs_.push_back(point.x);
+    ys_.push_back(point.y);
+  }
+
+  Point operator[](size_t index) const {
+    return Point(xs_[index], ys_[index]);
+  }
+
+  const T* xs() const {
+    return xs_.data();
+  }
+
+  const T* ys() const {
+    return ys_.data();
+  }
+
+  std::vector<Point> toPoints() const {
+    std::vector<Point> points(size());
+    for (size_t i = 0; i < size(); ++i) {
+      points[i] = (*this)[i];
     }
-    return true;
+    return points;
   }
 
-  bool containsPoint(const Point& point) override {
-    bool wasNeg = false;
-    bool wasPos = false;
-    for (size_t i = 0; i < vertices_.size(); ++i) {
-      size_t j = (i + 1) % vertices_.size();
-      int result = MathFunc::sign((vertices_[j] - vertices_[i]).crossProduct(point - vertices_[i]));
-      if (result == -1) {
-        wasNeg = true;
-      }
-      if (result == 1) {
-        wasPos = true;
+  //shoelace, positive for counterclockwise order; exact up to the final halving for integers. Coordinates are taken
+  //relative to the first vertex, otherwise far from the origin the cross products cancel catastrophically
+  Real signedArea() const {
+    const size_t count = size();
+    if (count < 3) {
+      return 0;
+    }
+    const T originX = xs_[0];
+    const T originY = ys_[0];
+    T result = 0;
+    size_t i = 1;
+#ifdef __AVX2__
+    if constexpr (std::is_same_v<T, double>) {
+      const __m256d broadcastX = _mm256_set1_pd(originX);
+      const __m256d broadcastY = _mm256_set1_pd(originY);
+      __m256d sum = _mm256_setzero_pd();
+      for (; i + 4 < count; i += 4) {
+        const __m256d x = _mm256_sub_pd(_mm256_loadu_pd(xs_.data() + i), broadcastX);
+        const __m256d y = _mm256_sub_pd(_mm256_loadu_pd(ys_.data() + i), broadcastY);
+        const __m256d nextX = _mm256_sub_pd(_mm256_loadu_pd(xs_.data() + i + 1), broadcastX);
+        const __m256d nextY = _mm256_sub_pd(_mm256_loadu_pd(ys_.data() + i + 1), broadcastY);
+        sum = _mm256_add_pd(sum, _mm256_sub_pd(_mm256_mul_pd(x, nextY), _mm256_mul_pd(nextX, y)));
       }
+      result = horizontalSum(sum);
     }
-    return !(wasNeg && wasPos);
+#endif
+    for (; i + 1 < count; ++i) { //the edges at the first vertex contribute nothing
+      result += (xs_[i] - originX) * (ys_[i + 1] - originY) - (xs_[i + 1] - originX) * (ys_[i] - originY);
+    }
+    return Traits::toReal(result) / 2;
   }
 
-  void rotate(const Point& center, fType angle) override {
-    angle = angle / 180.0 * M_PI;
-    for (size_t i = 0; i < vertices_.size(); ++i) {
-      vertices_[i] = center.rotate(vertices_[i], angle);
-    }
+  Real area() const {
+    return std::abs(signedArea());
   }
 
-  void reflect(const Point& center) override {
-    for (auto& p : vertices_) {
-      p = center.reflect(p);
+  Real perimeter() const {
+    const size_t count = size();
+    if (count < 2) {
+      return 0;
+    }
+    Real result = 0;
+    size_t i = 0;
+#ifdef __AVX2__
+    if constexpr (std::is_same_v<T, double>) {
+      __m256d sum = _mm256_setzero_pd();
+      for (; i + 4 < count; i += 4) {
+        const __m256d dx = _mm256_sub_pd(_mm256_loadu_pd(xs_.data() + i + 1), _mm256_loadu_pd(xs_.data() + i));
+        const __m256d dy = _mm256_sub_pd(_mm256_loadu_pd(ys_.data() + i + 1), _mm256_loadu_pd(ys_.data() + i));
+        sum = _mm256_add_pd(sum, _mm256_sqrt_pd(_mm256_add_pd(_mm256_mul_pd(dx, dx), _mm256_mul_pd(dy, dy))));
+      }
+      result = horizontalSum(sum);
+    }
+#endif
+    for (; i < count; ++i) {
+      const size_t next = i + 1 < count ? i + 1 : 0;
+      const T dx = xs_[next] - xs_[i];
+      const T dy = ys_[next] - ys_[i];
+      result += std::sqrt(Traits::toReal(dx * dx + dy * dy));
     }
+    return result;
   }
 
-  void reflect(const Line& axis) override {
-    for (Point& vertex : vertices_) {
-      vertex = axis.reflect(vertex);
+  BasicBoundingBox<T> boundingBox() const {
+    BasicBoundingBox<T> box;
+    size_t i = 0;
+#ifdef __AVX2__
+    if constexpr (std::is_same_v<T, double>) {
+      if (size() >= 4) {
+        __m256d minX = _mm256_loadu_pd(xs_.data());
+        __m256d minY = _mm256_loadu_pd(ys_.data());
+        __m256d maxX = minX;
+        __m256d maxY = minY;
+        for (i = 4; i + 4 <= size(); i += 4) {
+          const __m256d x = _mm256_loadu_pd(xs_.data() + i);
+          const __m256d y = _mm256_loadu_pd(ys_.data() + i);
+          minX = _mm256_min_pd(minX, x);
+          minY = _mm256_min_pd(minY, y);
+          maxX = _mm256_max_pd(maxX, x);
+          maxY = _mm256_max_pd(maxY, y);
+        }
+        alignas(32) double lanes[4][4];
+        _mm256_store_pd(lanes[0], minX);
+        _mm256_store_pd(lanes[1], minY);
+        _mm256_store_pd(lanes[2], maxX);
+        _mm256_store_pd(lanes[3], maxY);
+        for (size_t lane = 0; lane < 4; ++lane) {
+          box.extend(Point(lanes[0][lane], lanes[1][lane]));
+          box.extend(Point(lanes[2][lane], lanes[3][lane]));
+        }
+      }
     }
+#endif
+    for (; i < size(); ++i) {
+      box.extend((*this)[i]);
+    }
+    return box;
   }
 
-  void scale(const Point& center, fType coefficient) override {
-    for (Point& vertex : vertices_) {
-      vertex = center.scale(vertex, coefficient);
+  void applyTransform(const BasicAffineTransform<T>& transform) {
+    auto [xx, xy, x0, yx, yy, y0] = transform.getCoefficients();
+    size_t i = 0;
+#ifdef __AVX2__
+    if constexpr (std::is_same_v<T, double>) {
+      const __m256d vectorXX = _mm256_set1_pd(xx);
+      const __m256d vectorXY = _mm256_set1_pd(xy);
+      const __m256d vectorX0 = _mm256_set1_pd(x0);
+      const __m256d vectorYX = _mm256_set1_pd(yx);
+      const __m256d vectorYY = _mm256_set1_pd(yy);
+      const __m256d vectorY0 = _mm256_set1_pd(y0);
+      for (; i + 4 <= size(); i += 4) {
+        const __m256d x = _mm256_loadu_pd(xs_.data() + i);
+        const __m256d y = _mm256_loadu_pd(ys_.data() + i);
+        _mm256_storeu_pd(xs_.data() + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(vectorXX, x), _mm256_mul_pd(vectorXY, y)), vectorX0));
+        _mm256_storeu_pd(ys_.data() + i, _mm256_add_pd(_mm256_add_pd(_mm256_mul_pd(vectorYX, x), _mm256_mul_pd(vectorYY, y)), vectorY0));
+      }
+    }
+#endif
+    for (; i < size(); ++i) {
+      const auto x = Traits::toScalar(xs_[i]);
+      const auto y = Traits::toScalar(ys_[i]);
+      xs_[i] = Traits::fromScalar(xx * x + xy * y + x0);
+      ys_[i] = Traits::fromScalar(yx * x + yy * y + y0);
     }
   }
 
-protected:
-  std::vector<Point>vertices_;
 private:
-  std::optional<fType> getSimilarityСoefficient(const Shape& another) const {
-    const Polygon* anotherPointer = dynamic_cast<const Polygon*>(&another);
-    if (anotherPointer == nullptr) {
-      return std::nullopt;
-    }
-    auto anotherVertices = anotherPointer->getVertices();
-    if (anotherVertices.size() != vertices_.size()) {
-      return std::nullopt;
-    }
-    auto isSimilar = [&](const std::vector<Point>& anotherVertices, bool isInverseAngleСomparison) -> std::optional<fType> {
-      const int numberOfVertices = vertices_.size();
+  std::vector<T> xs_;
+  std::vector<T> ys_;
+
+#ifdef __AVX2__
+  static double horizontalSum(__m256d value) {
+    const __m128d pair = _mm_add_pd(_mm256_castpd256_pd128(value), _mm256_extractf128_pd(value, 1));
+    return _mm_cvtsd_f64(_mm_add_sd(pair, _mm_unpackhi_pd(pair, pair)));
+  }
+#endif
+};
+
+using VertexArray = BasicVertexArray<fType>;
+
+template<typename T>
+class BasicShape {
+public:
+  using Point = BasicPoint<T>;
+  using Real = typename CoordinateTraits<T>::Real;
+  using Scalar = typename CoordinateTraits<T>::Scalar;
+  using AffineTransform = BasicAffineTransform<T>;
+
+  virtual Real perimeter() const  = 0;
+
+  virtual Real area() const  = 0;
+
+  virtual bool isCongruentTo(const BasicShape& another) const = 0;
+
+  virtual bool isSimilarTo(const BasicShape& another) const = 0;
+
+  virtual bool containsPoint(const Point& point) const = 0;
+
+  virtual BasicBoundingBox<T> boundingBox() const = 0;
+
+  virtual void applyTransform(const AffineTransform& transform) = 0;
+
+  virtual void rotate(const Point& center, Real angle) { //angle in degrees
+    applyTransform(AffineTransform::rotation(center, angle / 180.0 * M_PI));
+  }
+
+  virtual void reflect(const Point& center) {
+    applyTransform(AffineTransform::reflection(center));
+  }
+
+  virtual void reflect(const BasicLine<T>& axis) {
+    applyTransform(AffineTransform::reflection(axis));
+  }
+
+  virtual void scale(const Point& center, Scalar coefficient) {
+    applyTransform(AffineTransform::scaling(center, coefficient));
+  }
+
+  virtual ~BasicShape() = default;
+
+  bool operator==(const BasicShape& rhs) const {
+    return isEqual(rhs);
+  }
+
+protected:
+  virtual bool isEqual(const BasicShape& another) const = 0;
+};
+
+using Shape = BasicShape<fType>;
+
+template<typename T>
+class BasicEllipse;
+
+template<typename T>
+void applyTransform(std::span<std::type_identity_t<BasicShape<T>>* const> shapes, const BasicAffineTransform<T>& transform) { //polygons only compose, nothing is rewritten here
+  if constexpr (std::is_floating_point_v<T>) { //an ellipse refuses a transform that is not a similarity; nothing moves in that case
+    if (!transform.isSimilarity()) {
+      for (const BasicShape<T>* shape : shapes) {
+        if (dynamic_cast<const BasicEllipse<T>*>(shape) != nullptr) {
+          BasicEllipse<T>::requireSimilarity(transform);
+        }
+      }
+    }
+  }
+  for (BasicShape<T>* shape : shapes) {
+    shape->applyTransform(transform);
+  }
+}
+
+template<typename T>
+T doubledSignedArea(const std::vector<BasicPoint<T>>& vertices) { //positive for counterclockwise order, exact for exact types
+  T result = 0;
+  if (vertices.size() < 3) {
+    return result;
+  }
+  //summed relative to the first vertex: absolute cross products far from the origin cancel catastrophically
+  const BasicPoint<T> origin = vertices.front();
+  for (size_t i = 1; i + 1 < vertices.size(); ++i) {
+    result += (vertices[i] - origin).crossProduct(vertices[i + 1] - origin);
+  }
+  return result;
+}
+
+//vertices of a convex polygon in counterclockwise order with repeated and collinear vertices removed, so every corner
+//turns strictly left; the region is unchanged
+template<typename T>
+std::vector<BasicPoint<T>> strictlyConvexVertices(std::vector<BasicPoint<T>> vertices) {
+  using Point = BasicPoint<T>;
+  if (doubledSignedArea<T>(vertices) < 0) {
+    std::reverse(vertices.begin(), vertices.end());
+  }
+  std::vector<Point> distinct;
+  for (const Point& vertex : vertices) {
+    if (distinct.empty() || vertex.x != distinct.back().x || vertex.y != distinct.back().y) {
+      distinct.push_back(vertex);
+    }
+  }
+  while (distinct.size() > 1 && distinct.front().x == distinct.back().x && distinct.front().y == distinct.back().y) {
+    distinct.pop_back();
+  }
+  std::vector<Point> result;
+  for (size_t i = 0; i < distinct.size(); ++i) {
+    const Point& previous = distinct[i > 0 ? i - 1 : distinct.size() - 1];
+    const Point& next = distinct[i + 1 < distinct.size() ? i + 1 : 0];
+    if (orientation(previous, distinct[i], next) != 0) {
+      result.push_back(distinct[i]);
+    }
+  }
+  return result;
+}
+
+//one edge of a winding number count: returns true if point lies on the edge, otherwise adds the signed crossing of the
+//rightward horizontal ray from point to winding
+template<typename T>
+bool windingStep(const BasicPoint<T>& from, const BasicPoint<T>& to, const BasicPoint<T>& point, int& winding) {
+  const int turn = orientation(from, to, point);
+  if (turn == 0 && std::min(from.x, to.x) <= point.x && point.x <= std::max(from.x, to.x)
+      && std::min(from.y, to.y) <= point.y && point.y <= std::max(from.y, to.y)) {
+    return true;
+  }
+  if (from.y <= point.y) {
+    if (to.y > point.y && turn > 0) { //upward crossing with the point on the left
+      ++winding;
+    }
+  } else if (to.y <= point.y && turn < 0) { //downward crossing with the point on the right
+    --winding;
+  }
+  return false;
+}
+
+//winding number with an early exit on the boundary (which counts as inside): O(n), no trigonometry, any simple polygon
+template<typename T>
+bool windingContains(std::span<const std::type_identity_t<BasicPoint<T>>> vertices, const BasicPoint<T>& point) {
+  int winding = 0;
+  for (size_t i = 0; i < vertices.size(); ++i) {
+    if (windingStep(vertices[i], vertices[i + 1 < vertices.size() ? i + 1 : 0], point, winding)) {
+      return true;
+    }
+  }
+  return winding != 0;
+}
+
+template<typename T>
+class BasicPolygon : public BasicShape<T> {
+public:
+  using Point = BasicPoint<T>;
+  using Traits = CoordinateTraits<T>;
+  using Real = typename Traits::Real;
+  using AffineTransform = BasicAffineTransform<T>;
+
+  BasicPolygon() = default;
+
+  BasicPolygon(const std::vector<Point>& points_)
+  : vertices_(points_)
+  {}
+
+  BasicPolygon(const BasicPolygon& other) //copying reads other, so a pending transform is flushed first like in any const query
+  : BasicShape<T>(other)
+  , vertices_(other.vertices())
+  {}
+
+  BasicPolygon(BasicPolygon&& other) noexcept
+  : BasicShape<T>(std::move(other))
+  , vertices_(std::move(other.vertices_))
+  , pendingTransform_(other.pendingTransform_)
+  , hasPendingTransform_(other.hasPendingTransform_.load(std::memory_order_relaxed))
+  {}
+
+  BasicPolygon& operator=(const BasicPolygon& other) {
+    if (this != &other) {
+      vertices_ = other.vertices();
+      pendingTransform_ = AffineTransform();
+      hasPendingTransform_.store(false, std::memory_order_relaxed);
+    }
+    return *this;
+  }
+
+  BasicPolygon& operator=(BasicPolygon&& other) noexcept {
+    vertices_ = std::move(other.vertices_);
+    pendingTransform_ = other.pendingTransform_;
+    hasPendingTransform_.store(other.hasPendingTransform_.load(std::memory_order_relaxed), std::memory_order_relaxed);
+    return *this;
+  }
+
+  BasicPolygon(std::vector<Point>&& points_) //takes the buffer over, readers build polygons with one allocation each
+  : vertices_(std::move(points_))
+  {}
+
+  BasicPolygon(const std::initializer_list<Point>& points_)
+  : vertices_(points_)
+  {}
+
+  explicit BasicPolygon(const BasicVertexArray<T>& vertices)
+  : vertices_(vertices.toPoints())
+  {}
+
+  template<typename ...Pts>
+  explicit BasicPolygon(const Pts&... pts)
+  : vertices_({pts...})
+  {}
+
+  std::vector<Point>getVertices() const {
+    return vertices();
+  }
+
+  size_t verticesCount() const {
+    return vertices_.size();
+  }
+
+  bool isConvex() const {
+    const std::vector<Point>& points = vertices();
+    bool wasNeg = false;
+    bool wasPos = false;
+    for (size_t i = 0; i < points.size(); ++i) {
+      size_t j = (i + 1) % points.size();
+      size_t k = (i + 2) % points.size();
+      int result = orientation(points[i], points[j], points[k]);
+      if (result == -1) {
+        wasNeg = true;
+      } else if (result == 1) {
+        wasPos = true;
+      }
+    }
+    return !(wasNeg && wasPos);
+  }
+
+  Real perimeter() const override {
+    const std::vector<Point>& points = vertices();
+    if (points.empty()) {
+      return 0;
+    }
+    Real result = (points.front() - points.back()).length();
+    for (size_t i = 0; i + 1 < points.size(); ++i) {
+      result += (points[i + 1] - points[i]).length();
+    }
+    return result;
+  }
+
+  Real area() const override { //shoelace relative to the first vertex, summed exactly for exact coordinate types
+    return std::abs(Traits::toReal(doubledSignedArea<T>(vertices())) / 2);
+  }
+
+  BasicBoundingBox<T> boundingBox() const override {
+    BasicBoundingBox<T> box;
+    for (const Point& point : vertices()) {
+      box.extend(point);
+    }
+    return box;
+  }
+
+  BasicVertexArray<T> toVertexArray() const {
+    return BasicVertexArray<T>(vertices());
+  }
+
+  bool isCongruentTo(const BasicShape<T>& another) const override {
+    auto result = getSimilarityСoefficient(another);
+    if (result) {
+      return CoordinateTraits<Real>::isEqual(*result, 1);
+    }
+    return false;
+  }
+
+  bool isSimilarTo(const BasicShape<T>& another) const override {
+    return getSimilarityСoefficient(another) != std::nullopt;
+  }
+
+  bool isEqual(const BasicShape<T>& another) const override {
+    const std::vector<Point>& points = vertices();
+    const BasicPolygon* anotherPointer = dynamic_cast<const BasicPolygon*>(&another);
+    if (anotherPointer == nullptr) {
+      return false;
+    }
+
+    std::vector<Point> anotherVertices = anotherPointer->getVertices();
+    if (anotherVertices.size() != points.size()) {
+      return false;
+    }
+
+    auto isEqual = [&](const std::vector<Point>& anotherVertices) {
+      const int numberOfVertices = points.size();
+      for (int shift = 0; shift <= numberOfVertices; ++shift) {
+        bool ok = true;
+        for (int i = 0; i < numberOfVertices && ok; ++i) {
+          ok &= points[i] == anotherVertices[(shift + i) % numberOfVertices];
+        }
+        if (ok) {
+          return true;
+        }
+      }
+      return false;
+    };
+
+    if (!isEqual(anotherVertices)) {
+      reverse(anotherVertices.begin(), anotherVertices.end());
+      return isEqual(anotherVertices);
+    }
+    return true;
+  }
+
+  bool containsPoint(const Point& point) const override { //boundary counts as inside, works for non-convex polygons too
+    return windingContains<T>(vertices(), point);
+  }
+
+  //composed lazily: a chain of transforms costs one 2x3 product each, vertices are rewritten once on the next query
+  void applyTransform(const AffineTransform& transform) override {
+    pendingTransform_ = transform * pendingTransform_;
+    hasPendingTransform_.store(!pendingTransform_.isIdentity(), std::memory_order_relaxed);
+  }
+
+  //safe to call from several threads at once, like every const query: the first reader flushes the pending transform
+  //under a lock, the others wait for it, and once it is applied readers only load the flag
+  const std::vector<Point>& vertices() const {
+    if (hasPendingTransform_.load(std::memory_order_acquire)) {
+      flushPendingTransform();
+    }
+    return vertices_;
+  }
+
+protected:
+  mutable std::vector<Point> vertices_;
+  mutable AffineTransform pendingTransform_;
+  mutable std::atomic<bool> hasPendingTransform_ = false;
+private:
+  static constexpr size_t kFlushLockStripes = 64; //a lock per polygon would double the size of small polygons
+
+  void flushPendingTransform() const {
+    static std::array<std::mutex, kFlushLockStripes> locks;
+    std::lock_guard lock(locks[std::hash<const void*>{}(this) % kFlushLockStripes]);
+    if (hasPendingTransform_.load(std::memory_order_relaxed)) {
+      pendingTransform_.apply(vertices_);
+      pendingTransform_ = AffineTransform();
+      hasPendingTransform_.store(false, std::memory_order_release);
+    }
+  }
+
+  std::optional<Real> getSimilarityСoefficient(const BasicShape<T>& another) const {
+    const std::vector<Point>& points = vertices();
+    const BasicPolygon* anotherPointer = dynamic_cast<const BasicPolygon*>(&another);
+    if (anotherPointer == nullptr) {
+      return std::nullopt;
+    }
+    auto anotherVertices = anotherPointer->getVertices();
+    if (anotherVertices.size() != points.size()) {
+      return std::nullopt;
+    }
+    auto isSimilar = [&](const std::vector<Point>& anotherVertices, bool isInverseAngleСomparison) -> std::optional<Real> {
+      const int numberOfVertices = points.size();
       for (int shift = 0; shift < numberOfVertices; ++shift) {
         bool ok = true;
-        fType ratio = (anotherVertices[(shift + 1) % numberOfVertices] - anotherVertices[shift]).length() / (vertices_[1] - vertices_[0]).length();
+        Real ratio = (anotherVertices[(shift + 1) % numberOfVertices] - anotherVertices[shift]).length() / (points[1] - points[0]).length();
         for (int i = 0; i < numberOfVertices && ok; ++i) {
-          ok &= MathFunc::floatisEqual(ratio,
+          ok &= CoordinateTraits<Real>::isEqual(ratio,
                                        (anotherVertices[(shift + i + 1) % numberOfVertices] - anotherVertices[(shift + i) % numberOfVertices]).length()
-                                        / (vertices_[(i + 1) % numberOfVertices] - vertices_[i]).length());
+                                        / (points[(i + 1) % numberOfVertices] - points[i]).length());
+
+          Point sideAnother1 = anotherVertices[(shift + i + 2) % numberOfVertices] - anotherVertices[(shift + i + 1) % numberOfVertices];
+          Point sideAnother2 = anotherVertices[(shift + i) % numberOfVertices] - anotherVertices[(shift + i + 1) % numberOfVertices];
+
+          Point sideThis1 = points[(i + 2) % numberOfVertices] - points[(i + 1) % numberOfVertices];
+          Point sideThis2 = points[i] - points[(i + 1) % numberOfVertices];
+
+          if (isInverseAngleСomparison) {
+            std::swap(sideThis1, sideThis2);
+          }
+          ok &= CoordinateTraits<Real>::isEqual(sideThis1.angleBetweenTwoVectors(sideThis2), sideAnother1.angleBetweenTwoVectors(sideAnother2));
+        }
+        if (ok) {
+          return ratio;
+        }
+      }
+      return std::nullopt;
+    };
+
+    auto tryOneWayOfAngleComparison = [&](std::vector<Point>& points_, bool isInverseAngleСomparison) {
+      std::optional<Real> similarityСoefficient = isSimilar(points_, isInverseAngleСomparison);
+      if (similarityСoefficient < 0) {
+        std::reverse(points_.begin(), points_.end());
+        return isSimilar(points_, isInverseAngleСomparison);
+      }
+      return similarityСoefficient;
+    };
+
+    auto similarityСoefficient = tryOneWayOfAngleComparison(anotherVertices, false);
+    if (similarityСoefficient) {
+      return similarityСoefficient;
+    }
+    return tryOneWayOfAngleComparison(anotherVertices, true);
+  }
+};
+
+using Polygon = BasicPolygon<fType>;
+
+//snapshot of a polygon prepared for many point queries: a bounding box rejects far points, convex polygons are searched
+//in O(log n) over the fan of triangles from the first vertex, the rest fall back to the winding number
+template<typename T>
+class BasicPreparedPolygon {
+public:
+  using Point = BasicPoint<T>;
+
+  explicit BasicPreparedPolygon(const BasicPolygon<T>& polygon)
+  : vertices_(polygon.vertices())
+  , isConvex_(vertices_.size() >= 3 && polygon.isConvex())
+  , box_(polygon.boundingBox())
+  {
+    if (isConvex_ && doubledSignedArea<T>(vertices_) != 0) { //the fan search expects strictly convex counterclockwise corners
+      vertices_ = strictlyConvexVertices(std::move(vertices_));
+    }
+    isConvex_ = isConvex_ && vertices_.size() >= 3 && doubledSignedArea<T>(vertices_) > 0;
+    if (!isConvex_) {
+      vertices_ = polygon.vertices();
+    }
+  }
+
+  bool isConvex() const {
+    return isConvex_;
+  }
+
+  bool contains(const Point& point) const { //boundary counts as inside
+    if (!box_.contains(point)) {
+      return false;
+    }
+    return isConvex_ ? convexContains(point) : windingContains<T>(vertices_, point);
+  }
+
+  void containsPoints(std::span<const Point> points, std::span<bool> result) const {
+    assert(points.size() == result.size() && "One result per point");
+    for (size_t i = 0; i < points.size(); ++i) {
+      result[i] = contains(points[i]);
+    }
+  }
+
+  size_t countContained(std::span<const Point> points) const {
+    size_t count = 0;
+    for (const Point& point : points) {
+      count += contains(point);
+    }
+    return count;
+  }
+
+private:
+  std::vector<Point> vertices_;
+  bool isConvex_;
+  BasicBoundingBox<T> box_;
+
+  //the binary search needs every fan test to agree with the others, so floating point coordinates take the exact
+  //predicate even under GEOMETRY_FAST_PREDICATES: rounded products misjudge points on the boundary
+  static int turn(const Point& a, const Point& b, const Point& c) {
+    if constexpr (std::floating_point<T>) {
+      return Predicates::orientation(a.x, a.y, b.x, b.y, c.x, c.y);
+    } else {
+      return orientation(a, b, c);
+    }
+  }
+
+  bool convexContains(const Point& point) const {
+    const Point& origin = vertices_[0];
+    const size_t count = vertices_.size();
+    if (turn(origin, vertices_[1], point) < 0 || turn(origin, vertices_[count - 1], point) > 0) {
+      return false;
+    }
+    size_t low = 1;
+    size_t high = count - 1;
+    while (high - low > 1) { //the last fan edge that still has the point on its left
+      const size_t middle = (low + high) / 2;
+      if (turn(origin, vertices_[middle], point) >= 0) {
+        low = middle;
+      } else {
+        high = middle;
+      }
+    }
+    return turn(vertices_[low], vertices_[high], point) >= 0;
+  }
+};
+
+using PreparedPolygon = BasicPreparedPolygon<fType>;
+
+//canonical invariant of a polygon up to motions (Congruence) or motions and scaling (Similarity): per vertex the turning
+//angle and the next side length (relative to the perimeter for Similarity), quantized, taken counterclockwise from the
+//least rotation (Booth) of the polygon and of its mirror image. Equal shapes get equal signatures in O(n) with one atan2
+//per vertex, so a library can be deduplicated through std::unordered_set instead of pairwise isCongruentTo calls.
+//Values that fall on different sides of a quantization step compare unequal, so the exact methods stay the reference
+template<typename T>
+class BasicPolygonSignature {
+public:
+  using Point = BasicPoint<T>;
+  using Real = typename CoordinateTraits<T>::Real;
+
+  enum class Kind {
+    Congruence,
+    Similarity
+  };
+
+  static constexpr Real kLengthQuantum = 1e-6; //absolute for Congruence, fraction of the perimeter for Similarity
+  static constexpr Real kAngleQuantum = 1e-6; //radians
+
+  BasicPolygonSignature(const BasicPolygon<T>& polygon, Kind kind)
+  : kind_(kind)
+  {
+    std::vector<Point> points = polygon.vertices();
+    const Real perimeter = polygon.perimeter();
+    const Real lengthUnit = kLengthQuantum * (kind == Kind::Similarity && perimeter > 0 ? perimeter : 1);
+    std::vector<Token> direct = canonicalTokens(points, lengthUnit);
+    for (Point& point : points) { //mirror image
+      point.x = -point.x;
+    }
+    std::vector<Token> mirrored = canonicalTokens(points, lengthUnit);
+    tokens_ = std::min(direct, mirrored);
+
+    hash_ = std::hash<int>()(static_cast<int>(kind_));
+    for (const Token& token : tokens_) {
+      hash_ = combineHash(hash_, static_cast<size_t>(token.angle));
+      hash_ = combineHash(hash_, static_cast<size_t>(token.length));
+    }
+  }
+
+  Kind kind() const {
+    return kind_;
+  }
+
+  size_t hash() const {
+    return hash_;
+  }
+
+  friend bool operator==(const BasicPolygonSignature& lhs, const BasicPolygonSignature& rhs) {
+    return lhs.hash_ == rhs.hash_ && lhs.kind_ == rhs.kind_ && lhs.tokens_ == rhs.tokens_;
+  }
+
+private:
+  struct Token {
+    int64_t angle;
+    int64_t length;
+
+    auto operator<=>(const Token&) const = default;
+  };
+
+  Kind kind_;
+  std::vector<Token> tokens_;
+  size_t hash_ = 0;
+
+  static size_t combineHash(size_t seed, size_t value) {
+    return seed ^ (value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2));
+  }
+
+  static std::vector<Token> canonicalTokens(std::vector<Point> points, Real lengthUnit) {
+    if (doubledSignedArea<T>(points) < 0) {
+      std::reverse(points.begin(), points.end());
+    }
+    const size_t count = points.size();
+    std::vector<Token> tokens(count);
+    for (size_t i = 0; i < count; ++i) {
+      const Point incoming = points[i] - points[i > 0 ? i - 1 : count - 1];
+      const Point outgoing = points[i + 1 < count ? i + 1 : 0] - points[i];
+      tokens[i].angle = std::llround(incoming.angleBetweenTwoVectors(outgoing) / kAngleQuantum);
+      tokens[i].length = std::llround(outgoing.length() / lengthUnit);
+    }
+    std::rotate(tokens.begin(), tokens.begin() + static_cast<ptrdiff_t>(MathFunc::leastRotation(tokens)), tokens.end());
+    return tokens;
+  }
+};
+
+using PolygonSignature = BasicPolygonSignature<fType>;
+
+template<typename T>
+struct std::hash<BasicPolygonSignature<T>> {
+  size_t operator()(const BasicPolygonSignature<T>& signature) const {
+    return signature.hash();
+  }
+};
+
+//Andrew's monotone chain in O(n log n): the convex hull counterclockwise from the lowest-leftmost point, collinear points
+//excluded. Fewer than three distinct points give a polygon with that many vertices
+template<typename T = fType> //the default serves braced lists of points
+BasicPolygon<T> convexHull(std::vector<BasicPoint<T>> points) {
+  using Point = BasicPoint<T>;
+  std::sort(points.begin(), points.end(), [](const Point& lhs, const Point& rhs) {
+    return lhs.x < rhs.x || (lhs.x == rhs.x && lhs.y < rhs.y);
+  });
+  points.erase(std::unique(points.begin(), points.end(), [](const Point& lhs, const Point& rhs) {
+    return lhs.x == rhs.x && lhs.y == rhs.y;
+  }), points.end());
+  if (points.size() < 3) {
+    return BasicPolygon<T>(points);
+  }
+  std::vector<Point> hull(2 * points.size());
+  size_t size = 0;
+  for (size_t i = 0; i < points.size(); ++i) { //lower chain
+    while (size >= 2 && orientation(hull[size - 2], hull[size - 1], points[i]) <= 0) {
+      --size;
+    }
+    hull[size++] = points[i];
+  }
+  for (size_t i = points.size() - 1, lowerSize = size + 1; i-- > 0;) { //upper chain
+    while (size >= lowerSize && orientation(hull[size - 2], hull[size - 1], points[i]) <= 0) {
+      --size;
+    }
+    hull[size++] = points[i];
+  }
+  hull.resize(size - 1); //the last point repeats the first
+  return BasicPolygon<T>(hull);
+}
+
+//Minkowski sum of two convex polygons in O(n + m): the edges of both, each already sorted by polar angle from the
+//lowest vertex, are merged like two sorted lists. Degenerate operands (points, segments) go through the hull of all sums
+template<typename T>
+BasicPolygon<T> minkowskiSum(const BasicPolygon<T>& lhs, const BasicPolygon<T>& rhs) {
+  using Point = BasicPoint<T>;
+  assert(lhs.isConvex() && rhs.isConvex());
+  std::vector<Point> first = strictlyConvexVertices(lhs.vertices());
+  std::vector<Point> second = strictlyConvexVertices(rhs.vertices());
+  if (first.size() < 3 || second.size() < 3) {
+    std::vector<Point> sums;
+    for (const Point& left : lhs.vertices()) {
+      for (const Point& right : rhs.vertices()) {
+        sums.push_back(left + right);
+      }
+    }
+    return convexHull(std::move(sums));
+  }
+  auto lowest = [](std::vector<Point>& points) {
+    return std::min_element(points.begin(), points.end(), [](const Point& lhs, const Point& rhs) {
+      return lhs.y < rhs.y || (lhs.y == rhs.y && lhs.x < rhs.x);
+    });
+  };
+  std::rotate(first.begin(), lowest(first), first.end());
+  std::rotate(second.begin(), lowest(second), second.end());
+
+  const size_t n = first.size();
+  const size_t m = second.size();
+  std::vector<Point> result;
+  result.reserve(n + m);
+  size_t i = 0;
+  size_t j = 0;
+  while (i < n || j < m) {
+    result.push_back(first[i % n] + second[j % m]);
+    const T turn = (first[(i + 1) % n] - first[i % n]).crossProduct(second[(j + 1) % m] - second[j % m]);
+    if (j == m || (i < n && turn > 0)) {
+      ++i;
+    } else if (i == n || turn < 0) {
+      ++j;
+    } else { //parallel edges become one
+      ++i;
+      ++j;
+    }
+  }
+  return BasicPolygon<T>(strictlyConvexVertices(std::move(result)));
+}
+
+//piecewise linear function of x given by the vertices of an x-monotone chain; evaluation at increasing x is amortized O(1).
+//Values are Scalar, so they stay exact for Rational coordinates
+template<typename T>
+class MonotoneChain {
+public:
+  using Point = BasicPoint<T>;
+  using Traits = CoordinateTraits<T>;
+  using Scalar = typename Traits::Scalar;
+
+  explicit MonotoneChain(std::vector<Point> points)
+  : points_(std::move(points))
+  {}
+
+  Scalar front() const {
+    return Traits::toScalar(points_.front().x);
+  }
+
+  Scalar back() const {
+    return Traits::toScalar(points_.back().x);
+  }
+
+  const std::vector<Point>& points() const {
+    return points_;
+  }
+
+  Scalar valueAt(const Scalar& x) { //x must not decrease between calls
+    while (cursor_ + 2 < points_.size() && Traits::toScalar(points_[cursor_ + 1].x) <= x) {
+      ++cursor_;
+    }
+    const Point& from = points_[cursor_];
+    const Point& to = points_[std::min(cursor_ + 1, points_.size() - 1)];
+    if (to.x == from.x) {
+      return Traits::toScalar(from.y);
+    }
+    const Scalar fromX = Traits::toScalar(from.x);
+    const Scalar fromY = Traits::toScalar(from.y);
+    const Scalar t = std::clamp((x - fromX) / (Traits::toScalar(to.x) - fromX), Scalar(0), Scalar(1));
+    return fromY + (Traits::toScalar(to.y) - fromY) * t;
+  }
+
+private:
+  std::vector<Point> points_;
+  size_t cursor_ = 0;
+};
+
+//lower and upper boundaries of a strictly convex counterclockwise polygon, both from left to right; vertical sides
+//at the ends are left out, so at the ends the lower chain starts and finishes at the lowest and the upper at the highest point
+template<typename T>
+std::pair<MonotoneChain<T>, MonotoneChain<T>> monotoneChains(const std::vector<BasicPoint<T>>& points) {
+  using Point = BasicPoint<T>;
+  const size_t count = points.size();
+  auto lessLeft = [](const Point& lhs, const Point& rhs) {
+    return lhs.x < rhs.x || (lhs.x == rhs.x && lhs.y < rhs.y);
+  };
+  const size_t left = static_cast<size_t>(std::min_element(points.begin(), points.end(), lessLeft) - points.begin());
+  const size_t right = static_cast<size_t>(std::max_element(points.begin(), points.end(), lessLeft) - points.begin());
+  std::vector<Point> lower;
+  for (size_t i = left;; i = (i + 1) % count) { //counterclockwise from the leftmost point runs along the bottom
+    if (lower.empty() || points[i].x != lower.back().x) {
+      lower.push_back(points[i]);
+    }
+    if (i == right) {
+      break;
+    }
+  }
+  std::vector<Point> upper;
+  for (size_t i = right;; i = (i + 1) % count) { //and back along the top; a vertical side keeps the higher end
+    if (upper.empty() || points[i].x != upper.back().x) {
+      upper.push_back(points[i]);
+    }
+    if (i == left) {
+      break;
+    }
+  }
+  std::reverse(upper.begin(), upper.end());
+  return {MonotoneChain<T>(std::move(lower)), MonotoneChain<T>(std::move(upper))};
+}
+
+//intersection of two convex polygons in O(n + m). Over the common x range the region is bounded by the lower of the two
+//upper chains and the higher of the two lower chains; both are linear between the merged vertex abscissas except for at
+//most one crossing per interval, and their gap is concave, so the nonnegative part is a single interval.
+//Returns an empty polygon if the interiors do not overlap. The bounds are traced in Scalar arithmetic, exact for Rational;
+//integer coordinates round the new corners to the grid
+template<typename T>
+BasicPolygon<T> convexIntersection(const BasicPolygon<T>& lhs, const BasicPolygon<T>& rhs) {
+  using Point = BasicPoint<T>;
+  using Traits = CoordinateTraits<T>;
+  using Scalar = typename Traits::Scalar;
+  assert(lhs.isConvex() && rhs.isConvex());
+  const std::vector<Point> first = strictlyConvexVertices(lhs.vertices());
+  const std::vector<Point> second = strictlyConvexVertices(rhs.vertices());
+  if (first.size() < 3 || second.size() < 3) {
+    return BasicPolygon<T>();
+  }
+  auto [firstLower, firstUpper] = monotoneChains(first);
+  auto [secondLower, secondUpper] = monotoneChains(second);
+  const Scalar from = std::max(firstLower.front(), secondLower.front());
+  const Scalar to = std::min(firstLower.back(), secondLower.back());
+  if (!(from < to)) {
+    return BasicPolygon<T>();
+  }
+
+  std::vector<Scalar> breaks{from, to};
+  for (const MonotoneChain<T>* chain : {&firstLower, &firstUpper, &secondLower, &secondUpper}) {
+    const size_t middle = breaks.size();
+    for (const Point& point : chain->points()) {
+      const Scalar x = Traits::toScalar(point.x);
+      if (from < x && x < to) {
+        breaks.push_back(x);
+      }
+    }
+    std::inplace_merge(breaks.begin(), breaks.begin() + static_cast<ptrdiff_t>(middle), breaks.end());
+  }
+  breaks.erase(std::unique(breaks.begin(), breaks.end()), breaks.end());
+
+  struct Sample {
+    Scalar x;
+    Scalar lower;
+    Scalar upper;
+  };
+  std::vector<Sample> firstSamples(breaks.size());
+  std::vector<Sample> secondSamples(breaks.size());
+  for (size_t i = 0; i < breaks.size(); ++i) { //all four chains are linear between breaks
+    firstSamples[i] = {breaks[i], firstLower.valueAt(breaks[i]), firstUpper.valueAt(breaks[i])};
+    secondSamples[i] = {breaks[i], secondLower.valueAt(breaks[i]), secondUpper.valueAt(breaks[i])};
+  }
+  auto crossing = [](const Scalar& gap0, const Scalar& gap1) { //where a linear function changes sign, as a fraction of the interval
+    return (gap0 < 0 && gap1 > 0) || (gap0 > 0 && gap1 < 0) ? std::optional<Scalar>(gap0 / (gap0 - gap1)) : std::nullopt;
+  };
+  auto between = [](const Sample& from, const Sample& to, const Scalar& t) {
+    return Sample{from.x + (to.x - from.x) * t, from.lower + (to.lower - from.lower) * t, from.upper + (to.upper - from.upper) * t};
+  };
+  std::vector<Sample> samples; //the bounds of the intersection, linear between consecutive samples
+  samples.reserve(3 * breaks.size());
+  for (size_t i = 0; i < breaks.size(); ++i) {
+    if (i > 0) { //the two lower and the two upper chains swap at most once between breaks
+      std::vector<Scalar> swaps;
+      for (std::optional<Scalar> t : {crossing(firstSamples[i - 1].lower - secondSamples[i - 1].lower, firstSamples[i].lower - secondSamples[i].lower),
+                                     crossing(firstSamples[i - 1].upper - secondSamples[i - 1].upper, firstSamples[i].upper - secondSamples[i].upper)}) {
+        if (t.has_value()) {
+          swaps.push_back(*t);
+        }
+      }
+      std::sort(swaps.begin(), swaps.end());
+      for (const Scalar& t : swaps) {
+        const Sample first = between(firstSamples[i - 1], firstSamples[i], t);
+        const Sample second = between(secondSamples[i - 1], secondSamples[i], t);
+        samples.push_back({first.x, std::max(first.lower, second.lower), std::min(first.upper, second.upper)});
+      }
+    }
+    samples.push_back({breaks[i], std::max(firstSamples[i].lower, secondSamples[i].lower), std::min(firstSamples[i].upper, secondSamples[i].upper)});
+  }
+
+  std::vector<Sample> inside;
+  for (size_t i = 0; i < samples.size(); ++i) {
+    if (i > 0) {
+      if (std::optional<Scalar> t = crossing(samples[i - 1].upper - samples[i - 1].lower, samples[i].upper - samples[i].lower)) {
+        Sample meeting = between(samples[i - 1], samples[i], *t); //the bounds meet in between
+        meeting.upper = meeting.lower;
+        inside.push_back(meeting);
+      }
+    }
+    if (samples[i].upper >= samples[i].lower) {
+      inside.push_back(samples[i]);
+    }
+  }
+  std::vector<Point> result;
+  for (const Sample& sample : inside) {
+    result.emplace_back(Traits::fromScalar(sample.x), Traits::fromScalar(sample.lower));
+  }
+  for (size_t i = inside.size(); i-- > 0;) {
+    result.emplace_back(Traits::fromScalar(inside[i].x), Traits::fromScalar(inside[i].upper));
+  }
+  result = strictlyConvexVertices(std::move(result));
+  if (result.size() < 3) {
+    return BasicPolygon<T>();
+  }
+  return BasicPolygon<T>(result);
+}
+
+//Boolean operations on simple polygons of any shape (convex or not, either orientation). Every edge is split at all
+//points where the other boundary crosses or touches it, so each fragment lies entirely inside, outside or on the other
+//boundary; the fragments of the result are selected by that classification and linked into closed loops.
+//Split points are computed once and shared by both edges, and a vertex within kSnapTolerance of the other boundary
+//becomes a split point itself, so fragments meet exactly and shared sides are recognized by their endpoints without any
+//epsilon search. Inside/outside flips at every proper crossing, so point location is only needed where the boundaries
+//touch. Results are counterclockwise outer boundaries and clockwise holes; touching components come out as separate loops.
+//Exact coordinate types snap nothing: only points exactly on the other boundary become splits
+template<typename T>
+class BasicPolygonClipper {
+public:
+  using Point = BasicPoint<T>;
+  using Polygon = BasicPolygon<T>;
+  using Traits = CoordinateTraits<T>;
+  using Real = typename Traits::Real;
+  using Scalar = typename Traits::Scalar;
+  using BoundingBox = BasicBoundingBox<T>;
+
+  enum class Operation {
+    Intersection,
+    Union,
+    Difference //subject minus clip
+  };
+
+  static constexpr Real kSnapTolerance = 1e-10; //relative to the extent of both polygons
+
+  static std::vector<Polygon> clip(const Polygon& subject, const Polygon& clip, Operation operation) {
+    std::vector<Point> first = normalized(subject.vertices());
+    std::vector<Point> second = normalized(clip.vertices());
+    if (first.size() < 3) { //an empty subject
+      return operation == Operation::Union && second.size() >= 3 ? std::vector<Polygon>{Polygon(second)} : std::vector<Polygon>();
+    }
+    if (second.size() < 3) {
+      return operation == Operation::Intersection ? std::vector<Polygon>() : std::vector<Polygon>{Polygon(first)};
+    }
+    BoundingBox box;
+    for (const std::vector<Point>* points : {&first, &second}) {
+      for (const Point& point : *points) {
+        box.extend(point);
+      }
+    }
+    T tolerance = 0;
+    if constexpr (!Traits::kExact) {
+      tolerance = kSnapTolerance * std::max({box.max.x - box.min.x, box.max.y - box.min.y, T(1)});
+    }
+
+    const Point margin(tolerance, tolerance);
+    box.min = box.min - margin;
+    box.max = box.max + margin;
+    EdgeGrid firstGrid(first, box);
+    EdgeGrid secondGrid(second, box);
+
+    std::vector<Edge> firstEdges = edges(first);
+    std::vector<Edge> secondEdges = edges(second);
+    for (Edge& edge : firstEdges) {
+      BoundingBox edgeBox;
+      edgeBox.extend(edge.from - margin);
+      edgeBox.extend(edge.from + margin);
+      edgeBox.extend(edge.to - margin);
+      edgeBox.extend(edge.to + margin);
+      for (size_t index : secondGrid.candidates(edgeBox)) {
+        intersect(edge, secondEdges[index], tolerance);
+      }
+    }
+    const std::vector<Fragment> firstFragments = fragments(firstEdges);
+    const std::vector<Fragment> secondFragments = fragments(secondEdges);
+    const std::vector<bool> firstInside = insideFlags(firstFragments, secondGrid);
+    const std::vector<bool> secondInside = insideFlags(secondFragments, firstGrid);
+
+    std::map<std::tuple<T, T, T, T>, size_t> secondByEnds;
+    for (size_t i = 0; i < secondFragments.size(); ++i) {
+      secondByEnds.emplace(endsKey(secondFragments[i].from, secondFragments[i].to), i);
+    }
+    std::vector<bool> secondShared(secondFragments.size(), false);
+
+    std::vector<Fragment> selected;
+    for (size_t i = 0; i < firstFragments.size(); ++i) {
+      const Fragment& fragment = firstFragments[i];
+      auto same = secondByEnds.find(endsKey(fragment.from, fragment.to));
+      auto opposite = secondByEnds.find(endsKey(fragment.to, fragment.from));
+      if (same != secondByEnds.end() || opposite != secondByEnds.end()) { //a side of both polygons
+        secondShared[same != secondByEnds.end() ? same->second : opposite->second] = true;
+        if ((same != secondByEnds.end()) == (operation != Operation::Difference)) {
+          selected.push_back(fragment);
+        }
+        continue;
+      }
+      if (firstInside[i] == (operation == Operation::Intersection)) {
+        selected.push_back(fragment);
+      }
+    }
+    for (size_t i = 0; i < secondFragments.size(); ++i) {
+      if (secondShared[i]) {
+        continue;
+      }
+      if (operation == Operation::Difference) {
+        if (secondInside[i]) { //becomes part of a hole or a cut, traversed the other way
+          selected.push_back({secondFragments[i].to, secondFragments[i].from});
+        }
+      } else if (secondInside[i] == (operation == Operation::Intersection)) {
+        selected.push_back(secondFragments[i]);
+      }
+    }
+    return linkLoops(selected);
+  }
+
+private:
+  struct Split {
+    Point point;
+    bool crossing; //a proper crossing rather than a vertex of either polygon lying on the other edge
+  };
+
+  struct Edge {
+    Point from;
+    Point to;
+    std::vector<Split> splits;
+    bool fromTouches = false; //the end lies on the other boundary
+    bool toTouches = false;
+  };
 
-          Point sideAnother1 = anotherVertices[(shift + i + 2) % numberOfVertices] - anotherVertices[(shift + i + 1) % numberOfVertices];
-          Point sideAnother2 = anotherVertices[(shift + i) % numberOfVertices] - anotherVertices[(shift + i + 1) % numberOfVertices];
+  enum class Start { //how the other boundary meets a fragment at its start
+    Vertex, //not at all
+    Crossing,
+    Contact
+  };
 
-          Point sideThis1 = vertices_[(i + 2) % numberOfVertices] - vertices_[(i + 1) % numberOfVertices];
-          Point sideThis2 = vertices_[i] - vertices_[(i + 1) % numberOfVertices];
+  struct Fragment {
+    Point from;
+    Point to;
+    Start start = Start::Contact;
+  };
 
-          if (isInverseAngleСomparison) {
-            std::swap(sideThis1, sideThis2);
+  //uniform grid with about one cell per edge of a polygon: candidate edges for a box, and point location by a winding
+  //count over the cells to the right of the point only, so neither costs O(n) on typical inputs
+  class EdgeGrid {
+  public:
+    EdgeGrid(const std::vector<Point>& points, const BoundingBox& box)
+    : points_(points)
+    , box_(box)
+    , side_(std::max<size_t>(1, static_cast<size_t>(std::sqrt(static_cast<double>(points.size())))))
+    , cells_(side_ * side_)
+    , stamps_(points.size(), 0)
+    {
+      for (size_t i = 0; i < points_.size(); ++i) {
+        const Point& from = points_[i];
+        const Point& to = points_[i + 1 < points_.size() ? i + 1 : 0];
+        for (size_t row = rowOf(Traits::toReal(std::min(from.y, to.y))); row <= rowOf(Traits::toReal(std::max(from.y, to.y))); ++row) {
+          for (size_t column = columnOf(Traits::toReal(std::min(from.x, to.x))); column <= columnOf(Traits::toReal(std::max(from.x, to.x))); ++column) {
+            cells_[row * side_ + column].push_back(i);
           }
-          ok &= MathFunc::floatisEqual(sideThis1.angleBetweenTwoVectors(sideThis2), sideAnother1.angleBetweenTwoVectors(sideAnother2));
         }
-        if (ok) {
-          return ratio;
+      }
+    }
+
+    std::vector<size_t> candidates(const BoundingBox& query) { //edges whose cells meet query, each once
+      std::vector<size_t> result;
+      ++stamp_;
+      for (size_t row = rowOf(Traits::toReal(query.min.y)); row <= rowOf(Traits::toReal(query.max.y)); ++row) {
+        for (size_t column = columnOf(Traits::toReal(query.min.x)); column <= columnOf(Traits::toReal(query.max.x)); ++column) {
+          for (size_t index : cells_[row * side_ + column]) {
+            if (stamps_[index] != stamp_) {
+              stamps_[index] = stamp_;
+              result.push_back(index);
+            }
+          }
         }
       }
-      return std::nullopt;
-    };
+      return result;
+    }
 
-    auto tryOneWayOfAngleComparison = [&](std::vector<Point>& points_, bool isInverseAngleСomparison) {
-      std::optional<fType> similarityСoefficient = isSimilar(points_, isInverseAngleСomparison);
-      if (similarityСoefficient < 0) {
-        std::reverse(points_.begin(), points_.end());
-        return isSimilar(points_, isInverseAngleСomparison);
+    //whether the midpoint of from and to is inside, boundary included. Tested as from + to against the doubled polygon,
+    //which stays exact for integer and Rational coordinates
+    bool containsMidpoint(const Point& from, const Point& to) {
+      const Point point = from + to;
+      int winding = 0;
+      ++stamp_;
+      const size_t row = rowOf(Traits::toReal(point.y) / 2);
+      for (size_t column = columnOf(Traits::toReal(point.x) / 2); column < side_; ++column) {
+        for (size_t index : cells_[row * side_ + column]) {
+          if (stamps_[index] == stamp_) {
+            continue;
+          }
+          stamps_[index] = stamp_;
+          if (windingStep(points_[index] * T(2), points_[index + 1 < points_.size() ? index + 1 : 0] * T(2), point, winding)) {
+            return true;
+          }
+        }
       }
-      return similarityСoefficient;
-    };
+      return winding != 0;
+    }
 
-    auto similarityСoefficient = tryOneWayOfAngleComparison(anotherVertices, false);
-    if (similarityСoefficient) {
-      return similarityСoefficient;
+  private:
+    const std::vector<Point>& points_;
+    BoundingBox box_;
+    size_t side_;
+    std::vector<std::vector<size_t>> cells_;
+    std::vector<size_t> stamps_;
+    size_t stamp_ = 0;
+
+    size_t cellOf(Real value, const T& low, const T& high) const {
+      const Real realLow = Traits::toReal(low);
+      const Real realHigh = Traits::toReal(high);
+      if (!(realLow < realHigh)) { //a flat box, possible without a snap margin
+        return 0;
+      }
+      const Real position = (value - realLow) / (realHigh - realLow) * static_cast<Real>(side_);
+      return position <= 0 ? 0 : std::min(static_cast<size_t>(position), side_ - 1);
     }
-    return tryOneWayOfAngleComparison(anotherVertices, true);
+
+    size_t rowOf(Real y) const {
+      return cellOf(y, box_.min.y, box_.max.y);
+    }
+
+    size_t columnOf(Real x) const {
+      return cellOf(x, box_.min.x, box_.max.x);
+    }
+  };
+
+  static std::vector<Point> normalized(const std::vector<Point>& vertices) { //counterclockwise, no repeated vertices
+    std::vector<Point> result;
+    for (const Point& vertex : vertices) {
+      if (result.empty() || vertex.x != result.back().x || vertex.y != result.back().y) {
+        result.push_back(vertex);
+      }
+    }
+    while (result.size() > 1 && result.front().x == result.back().x && result.front().y == result.back().y) {
+      result.pop_back();
+    }
+    if (doubledSignedArea<T>(result) < 0) {
+      std::reverse(result.begin(), result.end());
+    }
+    return result;
+  }
+
+  static std::vector<Edge> edges(const std::vector<Point>& points) {
+    std::vector<Edge> result(points.size());
+    for (size_t i = 0; i < points.size(); ++i) {
+      result[i].from = points[i];
+      result[i].to = points[i + 1 < points.size() ? i + 1 : 0];
+    }
+    return result;
+  }
+
+  static std::tuple<T, T, T, T> endsKey(const Point& from, const Point& to) {
+    return {from.x, from.y, to.x, to.y};
+  }
+
+  static bool onSegment(const Point& point, const Point& from, const Point& to, const T& tolerance) {
+    if constexpr (Traits::kExact) {
+      return orientation(from, to, point) == 0 && std::min(from.x, to.x) <= point.x && point.x <= std::max(from.x, to.x)
+          && std::min(from.y, to.y) <= point.y && point.y <= std::max(from.y, to.y);
+    } else {
+      const Point direction = to - from;
+      const T length2 = direction.length2();
+      const T t = length2 > 0 ? std::clamp((point - from).dotProduct(direction) / length2, T(0), T(1)) : 0;
+      return (point - (from + direction * t)).length2() <= tolerance * tolerance;
+    }
+  }
+
+  static void intersect(Edge& first, Edge& second, const T& tolerance) {
+    //endpoints on the other segment cover touching and collinear overlaps and are exact already
+    const bool secondFrom = onSegment(second.from, first.from, first.to, tolerance);
+    const bool secondTo = onSegment(second.to, first.from, first.to, tolerance);
+    const bool firstFrom = onSegment(first.from, second.from, second.to, tolerance);
+    const bool firstTo = onSegment(first.to, second.from, second.to, tolerance);
+    if (secondFrom) {
+      first.splits.push_back({second.from, false});
+      second.fromTouches = true;
+    }
+    if (secondTo) {
+      first.splits.push_back({second.to, false});
+      second.toTouches = true;
+    }
+    if (firstFrom) {
+      second.splits.push_back({first.from, false});
+      first.fromTouches = true;
+    }
+    if (firstTo) {
+      second.splits.push_back({first.to, false});
+      first.toTouches = true;
+    }
+    if (secondFrom || secondTo || firstFrom || firstTo) {
+      return;
+    }
+    if (orientation(first.from, first.to, second.from) * orientation(first.from, first.to, second.to) < 0
+        && orientation(second.from, second.to, first.from) * orientation(second.from, second.to, first.to) < 0) {
+      const Point direction = first.to - first.from;
+      const Point otherDirection = second.to - second.from;
+      const T otherFromSide = otherDirection.crossProduct(first.from - second.from);
+      const T otherToSide = otherDirection.crossProduct(first.to - second.from);
+      const Scalar t = Traits::ratio(otherFromSide, otherFromSide - otherToSide);
+      const Point crossing(Traits::fromScalar(Traits::toScalar(first.from.x) + Traits::toScalar(direction.x) * t),
+                           Traits::fromScalar(Traits::toScalar(first.from.y) + Traits::toScalar(direction.y) * t));
+      first.splits.push_back({crossing, true});
+      second.splits.push_back({crossing, true});
+    }
+  }
+
+  static bool samePoint(const Point& lhs, const Point& rhs) {
+    return lhs.x == rhs.x && lhs.y == rhs.y;
+  }
+
+  static std::vector<Fragment> fragments(std::vector<Edge>& edges) {
+    std::vector<Fragment> result;
+    for (size_t i = 0; i < edges.size(); ++i) {
+      Edge& edge = edges[i];
+      const Point direction = edge.to - edge.from;
+      std::sort(edge.splits.begin(), edge.splits.end(), [&](const Split& lhs, const Split& rhs) {
+        return (lhs.point - edge.from).dotProduct(direction) < (rhs.point - edge.from).dotProduct(direction);
+      });
+      Point current = edge.from;
+      Start start = edge.fromTouches || edges[i > 0 ? i - 1 : edges.size() - 1].toTouches ? Start::Contact : Start::Vertex;
+      for (const Split& split : edge.splits) {
+        if (samePoint(split.point, current)) { //several splits at one point
+          start = Start::Contact;
+        } else if (!samePoint(split.point, edge.to)) {
+          result.push_back({current, split.point, start});
+          current = split.point;
+          start = split.crossing ? Start::Crossing : Start::Contact;
+        }
+      }
+      result.push_back({current, edge.to, start});
+    }
+    return result;
+  }
+
+  //whether each fragment of one boundary lies inside the other polygon: located through the grid where the boundaries
+  //touch and propagated along the boundary elsewhere, flipping at proper crossings
+  static std::vector<bool> insideFlags(const std::vector<Fragment>& fragments, EdgeGrid& other) {
+    std::vector<bool> result(fragments.size());
+    for (size_t i = 0; i < fragments.size(); ++i) {
+      if (i == 0 || fragments[i].start == Start::Contact) {
+        result[i] = other.containsMidpoint(fragments[i].from, fragments[i].to);
+      } else {
+        result[i] = fragments[i].start == Start::Crossing ? !result[i - 1] : result[i - 1];
+      }
+    }
+    return result;
+  }
+
+  //at a vertex with several continuations the sharpest left turn is taken, which keeps the region of the current loop
+  //on the left and separates components that only touch at a point
+  static std::vector<Polygon> linkLoops(const std::vector<Fragment>& selected) {
+    std::map<std::pair<T, T>, std::vector<size_t>> outgoing;
+    for (size_t i = 0; i < selected.size(); ++i) {
+      outgoing[{selected[i].from.x, selected[i].from.y}].push_back(i);
+    }
+    std::vector<bool> used(selected.size(), false);
+    std::vector<Polygon> result;
+    for (size_t start = 0; start < selected.size(); ++start) {
+      if (used[start]) {
+        continue;
+      }
+      std::vector<Point> loop;
+      size_t current = start;
+      while (!used[current]) {
+        used[current] = true;
+        loop.push_back(selected[current].from);
+        const Point incoming = selected[current].to - selected[current].from;
+        std::optional<size_t> next;
+        Real bestTurn = -std::numeric_limits<Real>::infinity();
+        for (size_t candidate : outgoing[{selected[current].to.x, selected[current].to.y}]) {
+          if (used[candidate] && candidate != start) {
+            continue;
+          }
+          const Real turn = incoming.angleBetweenTwoVectors(selected[candidate].to - selected[candidate].from);
+          if (turn > bestTurn) {
+            bestTurn = turn;
+            next = candidate;
+          }
+        }
+        if (!next.has_value()) { //an open chain can only come from an invalid input such as a self-intersecting polygon
+          break;
+        }
+        current = *next;
+      }
+      loop = withoutStraightVertices(std::move(loop));
+      if (loop.size() >= 3) {
+        result.emplace_back(loop);
+      }
+    }
+    return result;
+  }
+
+  static std::vector<Point> withoutStraightVertices(std::vector<Point> loop) { //drops collinear vertices and spikes
+    bool changed = true;
+    while (changed && loop.size() >= 3) {
+      changed = false;
+      std::vector<Point> kept;
+      for (size_t i = 0; i < loop.size(); ++i) {
+        const Point& previous = kept.empty() ? loop.back() : kept.back();
+        const Point& next = loop[i + 1 < loop.size() ? i + 1 : 0];
+        if (orientation(previous, loop[i], next) == 0) {
+          changed = true;
+        } else {
+          kept.push_back(loop[i]);
+        }
+      }
+      loop = std::move(kept);
+    }
+    return loop;
   }
 };
 
-class Ellipse : public Shape {
+using PolygonClipper = BasicPolygonClipper<fType>;
+
+template<typename T>
+class BasicEllipse : public BasicShape<T> {
+  static_assert(std::is_floating_point_v<T>, "Ellipse needs floating point coordinates");
 public:
-  Ellipse() = default;
+  using Point = BasicPoint<T>;
+  using Line = BasicLine<T>;
+  using Vector = MathFunc::BasicVector<T>;
+  using AffineTransform = BasicAffineTransform<T>;
 
-  Ellipse(const Point& focus1, const Point& focus2, fType diameter)
+  BasicEllipse() = default;
+
+  BasicEllipse(const Point& focus1, const Point& focus2, T diameter)
     : focus1_(focus1), focus2_(focus2), diameter_(diameter)
   {}
 
@@ -449,9 +2266,9 @@ public:
 
   std::pair<Line, Line> directrices() const {
     Point middle =  (focus2_ + focus1_) / 2.0;
-    fType distance = diameter_ / (eccentricity() * 2.0);
+    T distance = diameter_ / (eccentricity() * 2.0);
 
-    MathFunc::Vector direction = (focus2_ - focus1_) / (focus2_ - focus1_).length() * distance;
+    Vector direction = (focus2_ - focus1_) / (focus2_ - focus1_).length() * distance;
     Point directrix1 = middle + Point(direction);
     Point directrix2 = middle - Point(direction);
 
@@ -461,39 +2278,39 @@ public:
     return std::make_pair(Line(directrix1, direction), Line(directrix2, direction));
   }
 
-  fType eccentricity() const {
+  T eccentricity() const {
     return (focus1_ - focus2_).length() / diameter_;
   }
 
-  fType perimeter() const override {
-     fType a = getGreatHalfAxis();
-     fType b = getLittleHalfAxis();
-     fType wtf = 3.0 * ((a - b) * (a - b)) / ((a + b) * (a + b));
+  T perimeter() const override {
+     T a = getGreatHalfAxis();
+     T b = getLittleHalfAxis();
+     T wtf = 3.0 * ((a - b) * (a - b)) / ((a + b) * (a + b));
      return M_PI * (a + b) * (1.0 + wtf / (10.0 + sqrt(4.0 - wtf)));
   }
 
-  fType area() const override {
+  T area() const override {
     return M_PI * getGreatHalfAxis() * getLittleHalfAxis();
   }
 
-  bool isCongruentTo(const Shape& another) const override {
-    const Ellipse* anotherPointer = dynamic_cast<const Ellipse*>(&another);
+  bool isCongruentTo(const BasicShape<T>& another) const override {
+    const BasicEllipse* anotherPointer = dynamic_cast<const BasicEllipse*>(&another);
     if (anotherPointer == nullptr) {
       return false;
     }
-    return MathFunc::floatisEqual(getGreatHalfAxis(), anotherPointer->getGreatHalfAxis()) && MathFunc::floatisEqual(getLittleHalfAxis(), anotherPointer->getLittleHalfAxis());
+    return CoordinateTraits<T>::isEqual(getGreatHalfAxis(), anotherPointer->getGreatHalfAxis()) && CoordinateTraits<T>::isEqual(getLittleHalfAxis(), anotherPointer->getLittleHalfAxis());
   }
 
-  bool isSimilarTo(const Shape& another) const override {
-    const Ellipse* anotherPointer = dynamic_cast<const Ellipse*>(&another);
+  bool isSimilarTo(const BasicShape<T>& another) const override {
+    const BasicEllipse* anotherPointer = dynamic_cast<const BasicEllipse*>(&another);
     if (anotherPointer == nullptr) {
       return false;
     }
-    return MathFunc::floatisEqual(eccentricity(), anotherPointer->eccentricity());
+    return CoordinateTraits<T>::isEqual(eccentricity(), anotherPointer->eccentricity());
   }
 
-  bool isEqual(const Shape& another) const override {
-    const Ellipse* anotherPointer = dynamic_cast<const Ellipse*>(&another);
+  bool isEqual(const BasicShape<T>& another) const override {
+    const BasicEllipse* anotherPointer = dynamic_cast<const BasicEllipse*>(&another);
     if (anotherPointer == nullptr) {
       return false;
     }
@@ -501,175 +2318,215 @@ public:
           ((focus1_ == anotherPointer->focus1_ && focus2_ == anotherPointer->focus2_)
             || (focus2_ == anotherPointer->focus1_ && focus1_ == anotherPointer->focus2_));}
 
-  bool containsPoint(const Point& point) override {
+  bool containsPoint(const Point& point) const override {
     return (point - focus1_).length() + (point - focus2_).length() <= diameter_;
   }
 
-  void rotate(const Point& center, fType angle) override {
-    angle = angle / 180.0 * M_PI;
-    focus1_ = center.rotate(focus1_ , angle);
-    focus2_ = center.rotate(focus2_, angle);
-  }
-
-  void reflect(const Point& center) override {
-    focus1_ = center.reflect(focus1_);
-    focus2_ = center.reflect(focus2_);
+  BasicBoundingBox<T> boundingBox() const override { //half-extents for the major axis direction u: sqrt(a^2 u.x^2 + b^2 u.y^2), sqrt(a^2 u.y^2 + b^2 u.x^2)
+    const T a = getGreatHalfAxis();
+    const T b = getLittleHalfAxis();
+    const T focalDistance = (focus2_ - focus1_).length();
+    const Point direction = focalDistance > 0 ? (focus2_ - focus1_) / focalDistance : Point(1, 0);
+    const Point halfExtent(std::sqrt(a * a * direction.x * direction.x + b * b * direction.y * direction.y),
+                           std::sqrt(a * a * direction.y * direction.y + b * b * direction.x * direction.x));
+    const Point center = (focus1_ + focus2_) / 2.0;
+    return BasicBoundingBox<T>{center - halfExtent, center + halfExtent};
   }
 
-  void reflect(const Line& axis) override {
-    focus1_ = axis.reflect(focus1_);
-    focus2_ = axis.reflect(focus2_);
+  //other maps turn an ellipse into one with different foci, so they are refused in release builds too
+  static void requireSimilarity(const AffineTransform& transform) {
+    if (!transform.isSimilarity()) {
+      throw std::invalid_argument("Ellipse supports only rotations, reflections and uniform scaling");
+    }
   }
 
-  void scale(const Point& center, fType coefficient) override {
-    focus1_ = center.scale(focus1_, coefficient);
-    focus2_ = center.scale(focus2_, coefficient);
-    diameter_ *= fabs(coefficient);
+  void applyTransform(const AffineTransform& transform) override { //only similarities map an ellipse to an ellipse with these foci
+    requireSimilarity(transform);
+    focus1_ = transform.apply(focus1_);
+    focus2_ = transform.apply(focus2_);
+    diameter_ *= transform.similarityRatio();
   }
 
 protected:
   Point focus1_, focus2_;
-  fType diameter_;
+  T diameter_;
 
-  fType getGreatHalfAxis() const {
+  T getGreatHalfAxis() const {
     return diameter_ / 2.0;
   }
 
-  fType getLittleHalfAxis() const {
+  T getLittleHalfAxis() const {
     return sqrt(diameter_ * diameter_ - (focus2_ - focus1_).length2()) / 2.0;
   }
 };
 
-class Circle final : public Ellipse {
+using Ellipse = BasicEllipse<fType>;
+
+template<typename T>
+class BasicCircle final : public BasicEllipse<T> {
 public:
-  Circle(const Point& center, fType radius)
-    : Ellipse(center, center, radius * 2.0)
+  using Point = BasicPoint<T>;
+
+  BasicCircle(const Point& center, T radius)
+    : BasicEllipse<T>(center, center, radius * 2.0)
   {}
 
-  fType radius() const {
-    return diameter_ / 2.0;
+  T radius() const {
+    return this->diameter_ / 2.0;
   }
 
-  fType perimeter() const final {
-    return M_PI * diameter_;
+  T perimeter() const final {
+    return M_PI * this->diameter_;
   }
 
-  fType area() const final {
-    return M_PI * diameter_ * diameter_ / 4.0;
+  T area() const final {
+    return M_PI * this->diameter_ * this->diameter_ / 4.0;
   }
 
   Point center() const {
-    return focus1_;
+    return this->focus1_;
   }
 };
 
-class Rectangle : public Polygon {
-public:
-  using Polygon::Polygon;
-
-  Rectangle() = default;
-
-  Rectangle (const Point& vertex1, const Point& vertex2, fType ratio) {
-    fType diag2 = (vertex2 - vertex1).length2();
+using Circle = BasicCircle<fType>;
 
-    fType lessEdge = sqrt(diag2 / (ratio * ratio + 1));
-    fType bigEdge = ratio * lessEdge;
+//the corners are computed in Real and rounded back for integer coordinates
+template<typename T>
+class BasicRectangle : public BasicPolygon<T> {
+public:
+  using Point = BasicPoint<T>;
+  using Line = BasicLine<T>;
+  using Real = typename CoordinateTraits<T>::Real;
+  using BasicPolygon<T>::BasicPolygon;
+  using BasicPolygon<T>::vertices;
+
+  BasicRectangle() = default;
+
+  BasicRectangle (const Point& vertex1, const Point& vertex2, Real ratio) {
+    using Traits = CoordinateTraits<T>;
+    const Real dx = Traits::toReal(vertex2.x - vertex1.x);
+    const Real dy = Traits::toReal(vertex2.y - vertex1.y);
+    Real diag2 = dx * dx + dy * dy;
+
+    Real lessEdge = sqrt(diag2 / (ratio * ratio + 1));
+    Real bigEdge = ratio * lessEdge;
     if (lessEdge > bigEdge) {
       std::swap(lessEdge, bigEdge);
     }
 
-    fType diagonal = sqrt(diag2);
+    Real diagonal = sqrt(diag2);
 
-    fType height = lessEdge * bigEdge / diagonal;
-    fType smallHeightProjection = lessEdge * lessEdge / diagonal;
+    Real height = lessEdge * bigEdge / diagonal;
+    Real smallHeightProjection = lessEdge * lessEdge / diagonal;
 
-    Point direction = (vertex2 - vertex1) / (vertex2 - vertex1).length();
-    Point perpendicularDirection = direction.perpendicular();
+    const Real directionX = dx / diagonal;
+    const Real directionY = dy / diagonal;
+    const Real x1 = Traits::toReal(vertex1.x);
+    const Real y1 = Traits::toReal(vertex1.y);
+    const Real x2 = Traits::toReal(vertex2.x);
+    const Real y2 = Traits::toReal(vertex2.y);
 
-    Point pointC = vertex1 + direction * smallHeightProjection + perpendicularDirection * height;
-    Point pointD = vertex2 - direction * smallHeightProjection - perpendicularDirection * height;
+    Point pointC = Point::fromReal(x1 + directionX * smallHeightProjection - directionY * height,
+                                   y1 + directionY * smallHeightProjection + directionX * height);
+    Point pointD = Point::fromReal(x2 - directionX * smallHeightProjection + directionY * height,
+                                   y2 - directionY * smallHeightProjection - directionX * height);
 
-    vertices_ = {vertex1, pointC, vertex2, pointD};
+    this->vertices_ = {vertex1, pointC, vertex2, pointD};
   }
 
-  Rectangle (const Point& vertex1, const Point& vertex2, int ratio)
-  : Rectangle(vertex1, vertex2, static_cast<fType>(ratio))
+  BasicRectangle (const Point& vertex1, const Point& vertex2, int ratio)
+  : BasicRectangle(vertex1, vertex2, static_cast<Real>(ratio))
   {}
 
   Point center() const {
-    return vertices_[0] + (vertices_[2] - vertices_[0]) / 2.0;
+    return vertices()[0] + (vertices()[2] - vertices()[0]) / T(2);
   }
 
   std::pair<Line, Line> diagonals() const {
-    return std::make_pair(Line(vertices_[0], vertices_[2]), Line(vertices_[1], vertices_[3]));
+    return std::make_pair(Line(vertices()[0], vertices()[2]), Line(vertices()[1], vertices()[3]));
   }
 
-  fType perimeter() const override {
-    return 2 * ((vertices_[1] - vertices_[0]).length() + (vertices_[1] - vertices_[2]).length());
+  Real perimeter() const override {
+    return 2 * ((vertices()[1] - vertices()[0]).length() + (vertices()[1] - vertices()[2]).length());
   }
 
-  fType area() const override {
-      return (vertices_[1] - vertices_[0]).length() * (vertices_[1] - vertices_[2]).length();
+  Real area() const override {
+      return (vertices()[1] - vertices()[0]).length() * (vertices()[1] - vertices()[2]).length();
   }
 };
 
-class Square final: public Rectangle {
+using Rectangle = BasicRectangle<fType>;
+
+template<typename T>
+class BasicSquare final: public BasicRectangle<T> {
 public:
-  using Rectangle::Rectangle;
+  using Point = BasicPoint<T>;
+  using BasicRectangle<T>::BasicRectangle;
+  using BasicRectangle<T>::vertices;
+  using BasicRectangle<T>::center;
 
-  Square() = default;
+  BasicSquare() = default;
 
-  Square(const Point& vertex1, const Point& vertex2)
-    : Rectangle(vertex1, vertex2, 1.0)
+  BasicSquare(const Point& vertex1, const Point& vertex2)
+    : BasicRectangle<T>(vertex1, vertex2, 1.0)
   {}
 
-  Circle circumscribedCircle() const {
-    return Circle(center(), std::sqrt(2.0 * (vertices_[1] - vertices_[0]).length2()));
+  BasicCircle<T> circumscribedCircle() const {
+    return BasicCircle<T>(center(), std::sqrt(2.0 * (vertices()[1] - vertices()[0]).length2()));
   }
 
-  Circle inscribedCircle() const {
-    return Circle(center(), (vertices_[1] - vertices_[0]).length() / 2.0);
+  BasicCircle<T> inscribedCircle() const {
+    return BasicCircle<T>(center(), (vertices()[1] - vertices()[0]).length() / 2.0);
   }
 };
 
-class Triangle final : public Polygon {
+using Square = BasicSquare<fType>;
+
+template<typename T>
+class BasicTriangle final : public BasicPolygon<T> {
 public:
-  using Polygon::Polygon;
+  using Point = BasicPoint<T>;
+  using Line = BasicLine<T>;
+  using Vector = MathFunc::BasicVector<T>;
+  using BasicPolygon<T>::BasicPolygon;
+  using BasicPolygon<T>::vertices;
+  using BasicPolygon<T>::area;
+  using BasicPolygon<T>::perimeter;
 
-  Triangle() = default;
+  BasicTriangle() = default;
 
-  Circle circumscribedCircle() const {
-    Point middle01 = (vertices_[1] + vertices_[0]) / 2.0;
-    Point middle12 = (vertices_[2] + vertices_[1]) / 2.0;
+  BasicCircle<T> circumscribedCircle() const {
+    Point middle01 = (vertices()[1] + vertices()[0]) / T(2);
+    Point middle12 = (vertices()[2] + vertices()[1]) / T(2);
 
-    MathFunc::Vector perpendicular01 = (vertices_[0] - vertices_[1]).perpendicular();
-    MathFunc::Vector perpendicular12 = (vertices_[1] - vertices_[2]).perpendicular();
+    Vector perpendicular01 = (vertices()[0] - vertices()[1]).perpendicular();
+    Vector perpendicular12 = (vertices()[1] - vertices()[2]).perpendicular();
 
     Point mid =Line(middle01, perpendicular01).intersection(Line(middle12, perpendicular12));
 
-    return Circle(mid, (vertices_[0] - mid).length());
+    return BasicCircle<T>(mid, (vertices()[0] - mid).length());
   }
 
-  Circle inscribedCircle() const {
-    return Circle(orthocenter(), area() * 2.0 / perimeter());
+  BasicCircle<T> inscribedCircle() const {
+    return BasicCircle<T>(orthocenter(), area() * 2.0 / perimeter());
   }
 
   Point centroid() const {
-    Point middle01 = (vertices_[1] + vertices_[0]) / 2.0;
-    Point middle12 = (vertices_[2] + vertices_[1]) / 2.0;
-    return Line(vertices_[2], middle01).intersection(Line(vertices_[0], middle12));
+    Point middle01 = (vertices()[1] + vertices()[0]) / T(2);
+    Point middle12 = (vertices()[2] + vertices()[1]) / T(2);
+    return Line(vertices()[2], middle01).intersection(Line(vertices()[0], middle12));
   }
 
   Point orthocenter() const {
-    MathFunc::Vector bisector102 = (vertices_[1] - vertices_[0]).bisector(vertices_[2] - vertices_[0]);
-    MathFunc::Vector bisector012 = (vertices_[0] - vertices_[1]).bisector(vertices_[2] - vertices_[1]);
-    return Line(vertices_[0], bisector102).intersection(Line(vertices_[1], bisector012));
+    Vector bisector102 = (vertices()[1] - vertices()[0]).bisector(vertices()[2] - vertices()[0]);
+    Vector bisector012 = (vertices()[0] - vertices()[1]).bisector(vertices()[2] - vertices()[1]);
+    return Line(vertices()[0], bisector102).intersection(Line(vertices()[1], bisector012));
   }
 
-  Circle ninePointsCircle() const {
+  BasicCircle<T> ninePointsCircle() const {
     auto circle = circumscribedCircle();
-    Point mid = (orthocenter() + circle.center()) / 2.0;
-    return Circle(mid, circle.radius() / 2.0);
+    Point mid = (orthocenter() + circle.center()) / T(2);
+    return BasicCircle<T>(mid, circle.radius() / 2.0);
   }
 
   Line EulerLine() const {
@@ -677,5 +2534,496 @@ public:
   }
 };
 
+using Triangle = BasicTriangle<fType>;
+
+//shapes stored by value in one contiguous array per concrete type, so batch operations run over each array with the
+//type known statically: calls are qualified (or on final classes) and never go through the vtable, and there is no
+//pointer chasing between heap objects. Iteration order is by type in the order of Shapes, then by insertion
+template<typename... Shapes>
+class BasicShapeCollection {
+public:
+  using Point = typename std::tuple_element_t<0, std::tuple<Shapes...>>::Point;
+  using Real = typename CoordinateTraits<decltype(Point::x)>::Real;
+  using AffineTransform = BasicAffineTransform<decltype(Point::x)>;
+
+  template<typename ShapeType>
+  ShapeType& add(ShapeType shape) {
+    return array<ShapeType>().emplace_back(std::move(shape));
+  }
+
+  template<typename ShapeType>
+  void reserve(size_t capacity) {
+    array<ShapeType>().reserve(capacity);
+  }
+
+  template<typename ShapeType>
+  std::span<ShapeType> shapes() {
+    return array<ShapeType>();
+  }
+
+  template<typename ShapeType>
+  std::span<const ShapeType> shapes() const {
+    return array<ShapeType>();
+  }
+
+  size_t size() const {
+    return (std::get<std::vector<Shapes>>(arrays_).size() + ...);
+  }
+
+  bool empty() const {
+    return size() == 0;
+  }
+
+  void clear() {
+    (std::get<std::vector<Shapes>>(arrays_).clear(), ...);
+  }
+
+  template<typename Function>
+  void forEach(Function function) { //function is instantiated once per shape type
+    (forEachOf<Shapes>(function), ...);
+  }
+
+  template<typename Function>
+  void forEach(Function function) const {
+    (forEachOf<Shapes>(function), ...);
+  }
+
+  Real totalArea() const {
+    Real result = 0;
+    forEach([&]<typename ShapeType>(const ShapeType& shape) { result += shape.ShapeType::area(); });
+    return result;
+  }
+
+  Real totalPerimeter() const {
+    Real result = 0;
+    forEach([&]<typename ShapeType>(const ShapeType& shape) { result += shape.ShapeType::perimeter(); });
+    return result;
+  }
+
+  void applyTransform(const AffineTransform& transform) { //polygons compose it lazily, ellipses are moved at once
+    using T = decltype(Point::x);
+    if constexpr ((std::is_base_of_v<BasicEllipse<T>, Shapes> || ...)) { //checked before any shape moves, a refused transform changes nothing
+      if (((std::is_base_of_v<BasicEllipse<T>, Shapes> && !array<Shapes>().empty()) || ...)) {
+        BasicEllipse<T>::requireSimilarity(transform);
+      }
+    }
+    forEach([&]<typename ShapeType>(ShapeType& shape) { shape.ShapeType::applyTransform(transform); });
+  }
+
+  size_t countContaining(const Point& point) const {
+    size_t count = 0;
+    forEachContaining(point, [&](const auto&) { ++count; });
+    return count;
+  }
+
+  template<typename Function>
+  void forEachContaining(const Point& point, Function function) const {
+    forEach([&]<typename ShapeType>(const ShapeType& shape) {
+      if (shape.ShapeType::containsPoint(point)) {
+        function(shape);
+      }
+    });
+  }
+
+  BasicBoundingBox<decltype(Point::x)> boundingBox() const {
+    BasicBoundingBox<decltype(Point::x)> box;
+    forEach([&]<typename ShapeType>(const ShapeType& shape) { box.extend(shape.ShapeType::boundingBox()); });
+    return box;
+  }
+
+private:
+  std::tuple<std::vector<Shapes>...> arrays_;
+
+  template<typename ShapeType>
+  std::vector<ShapeType>& array() {
+    static_assert((std::is_same_v<ShapeType, Shapes> || ...), "The collection has no array for this shape type");
+    return std::get<std::vector<ShapeType>>(arrays_);
+  }
+
+  template<typename ShapeType>
+  const std::vector<ShapeType>& array() const {
+    static_assert((std::is_same_v<ShapeType, Shapes> || ...), "The collection has no array for this shape type");
+    return std::get<std::vector<ShapeType>>(arrays_);
+  }
+
+  template<typename ShapeType, typename Function>
+  void forEachOf(Function& function) {
+    for (ShapeType& shape : array<ShapeType>()) {
+      function(shape);
+    }
+  }
+
+  template<typename ShapeType, typename Function>
+  void forEachOf(Function& function) const {
+    for (const ShapeType& shape : array<ShapeType>()) {
+      function(shape);
+    }
+  }
+};
+
+using ShapeCollection = BasicShapeCollection<Polygon, Rectangle, Square, Triangle, Ellipse, Circle>;
+
+
+//R-tree over bounding boxes of shapes (not owned). Boxes are taken at insertion, so a shape has to be removed before it
+//is transformed and inserted again afterwards
+template<typename T>
+class BasicRTree {
+public:
+  using Point = BasicPoint<T>;
+  using Shape = BasicShape<T>;
+  using BoundingBox = BasicBoundingBox<T>;
+  using Real = typename CoordinateTraits<T>::Real;
+
+  static const size_t kMaxEntries = 16;
+  static const size_t kMinEntries = 6;
+
+  BasicRTree() {
+    clear();
+  }
+
+  explicit BasicRTree(std::span<Shape* const> shapes) {
+    bulkLoad(shapes);
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+  void clear() {
+    nodes_.assign(1, Node());
+    freeNodes_.clear();
+    root_ = 0;
+    size_ = 0;
+  }
+
+  //Sort-Tile-Recursive packing: sqrt(n / M) vertical slices sorted by x, each sorted by y and cut into full nodes
+  void bulkLoad(std::span<Shape* const> shapes) {
+    clear();
+    std::vector<Entry> level;
+    level.reserve(shapes.size());
+    for (Shape* shape : shapes) {
+      level.push_back(Entry{shape->boundingBox(), 0, shape});
+    }
+    size_ = level.size();
+    if (level.empty()) {
+      return;
+    }
+    nodes_.clear();
+    bool isLeafLevel = true;
+    do {
+      level = packLevel(std::move(level), isLeafLevel);
+      isLeafLevel = false;
+    } while (level.size() > 1);
+    root_ = level.front().child;
+    nodes_[root_].parent = kNoNode;
+  }
+
+  void insert(Shape* shape) {
+    insertEntry(Entry{shape->boundingBox(), 0, shape});
+    ++size_;
+  }
+
+  bool remove(const Shape* shape) {
+    size_t leaf = kNoNode;
+    size_t position = 0;
+    if (!findLeaf(root_, shape, shape->boundingBox(), leaf, position)) {
+      return false;
+    }
+    std::vector<Entry>& entries = nodes_[leaf].entries;
+    entries.erase(entries.begin() + static_cast<ptrdiff_t>(position));
+    --size_;
+    condenseTree(leaf);
+    return true;
+  }
+
+  std::vector<Shape*> queryPoint(const Point& point) const { //shapes that contain the point
+    std::vector<Shape*> result;
+    visit([&](const BoundingBox& box) { return box.contains(point); }, [&](Shape* shape) {
+      if (shape->containsPoint(point)) {
+        result.push_back(shape);
+      }
+    });
+    return result;
+  }
+
+  std::vector<Shape*> queryRange(const BoundingBox& range) const { //shapes whose bounding boxes intersect the range
+    std::vector<Shape*> result;
+    visit([&](const BoundingBox& box) { return box.intersects(range); }, [&](Shape* shape) { result.push_back(shape); });
+    return result;
+  }
+
+  //k shapes with the nearest bounding boxes, closest first: best-first search over a queue ordered by box distance
+  std::vector<Shape*> nearest(const Point& point, size_t count) const {
+    using Candidate = std::tuple<Real, size_t, Shape*>; //distance, node (kNoNode for shapes), shape
+    std::priority_queue<Candidate, std::vector<Candidate>, std::greater<Candidate>> queue;
+    queue.emplace(0, root_, nullptr);
+    std::vector<Shape*> result;
+    while (!queue.empty() && result.size() < count) {
+      auto [distance, node, shape] = queue.top();
+      queue.pop();
+      if (node == kNoNode) {
+        result.push_back(shape);
+        continue;
+      }
+      for (const Entry& entry : nodes_[node].entries) {
+        queue.emplace(entry.box.distance2(point), nodes_[node].isLeaf ? kNoNode : entry.child, entry.shape);
+      }
+    }
+    return result;
+  }
+
+private:
+  static constexpr size_t kNoNode = static_cast<size_t>(-1);
+
+  struct Entry {
+    BoundingBox box;
+    size_t child = 0; //inner nodes
+    Shape* shape = nullptr; //leaves
+  };
+
+  struct Node {
+    bool isLeaf = true;
+    size_t parent = kNoNode;
+    std::vector<Entry> entries;
+  };
+
+  std::vector<Node> nodes_;
+  std::vector<size_t> freeNodes_;
+  size_t root_ = 0;
+  size_t size_ = 0;
+
+  size_t allocateNode(bool isLeaf) {
+    size_t index = nodes_.size();
+    if (freeNodes_.empty()) {
+      nodes_.emplace_back();
+    } else {
+      index = freeNodes_.back();
+      freeNodes_.pop_back();
+      nodes_[index] = Node();
+    }
+    nodes_[index].isLeaf = isLeaf;
+    return index;
+  }
+
+  BoundingBox nodeBox(size_t node) const {
+    BoundingBox box;
+    for (const Entry& entry : nodes_[node].entries) {
+      box.extend(entry.box);
+    }
+    return box;
+  }
+
+  template<typename Filter, typename Action>
+  void visit(Filter filter, Action action) const {
+    std::vector<size_t> stack = {root_};
+    while (!stack.empty()) {
+      const Node& node = nodes_[stack.back()];
+      stack.pop_back();
+      for (const Entry& entry : node.entries) {
+        if (!filter(entry.box)) {
+          continue;
+        }
+        if (node.isLeaf) {
+          action(entry.shape);
+        } else {
+          stack.push_back(entry.child);
+        }
+      }
+    }
+  }
+
+  std::vector<Entry> packLevel(std::vector<Entry> entries, bool isLeafLevel) {
+    const size_t nodeCount = (entries.size() + kMaxEntries - 1) / kMaxEntries;
+    const size_t sliceCount = static_cast<size_t>(std::ceil(std::sqrt(static_cast<double>(nodeCount))));
+    const size_t sliceSize = sliceCount * kMaxEntries;
+    auto byX = [](const Entry& lhs, const Entry& rhs) { return lhs.box.center().x < rhs.box.center().x; };
+    auto byY = [](const Entry& lhs, const Entry& rhs) { return lhs.box.center().y < rhs.box.center().y; };
+    std::sort(entries.begin(), entries.end(), byX);
+    std::vector<Entry> parents;
+    for (size_t slice = 0; slice < entries.size(); slice += sliceSize) {
+      const auto sliceBegin = entries.begin() + static_cast<ptrdiff_t>(slice);
+      const auto sliceEnd = entries.begin() + static_cast<ptrdiff_t>(std::min(slice + sliceSize, entries.size()));
+      std::sort(sliceBegin, sliceEnd, byY);
+      for (auto begin = sliceBegin; begin != sliceEnd;) {
+        const auto end = begin + std::min<ptrdiff_t>(static_cast<ptrdiff_t>(kMaxEntries), sliceEnd - begin);
+        const size_t node = allocateNode(isLeafLevel);
+        nodes_[node].entries.assign(begin, end);
+        for (const Entry& entry : nodes_[node].entries) {
+          if (!isLeafLevel) {
+            nodes_[entry.child].parent = node;
+          }
+        }
+        parents.push_back(Entry{nodeBox(node), node, nullptr});
+        begin = end;
+      }
+    }
+    return parents;
+  }
+
+  //adds the entry to the leaf whose box grows least (then the smallest one) and splits overflowing nodes up to the root
+  void insertEntry(const Entry& entry) {
+    size_t node = root_;
+    while (!nodes_[node].isLeaf) {
+      const std::vector<Entry>& entries = nodes_[node].entries;
+      size_t best = 0;
+      Real bestEnlargement = std::numeric_limits<Real>::infinity();
+      Real bestArea = std::numeric_limits<Real>::infinity();
+      for (size_t i = 0; i < entries.size(); ++i) {
+        BoundingBox merged = entries[i].box;
+        merged.extend(entry.box);
+        const Real enlargement = merged.area() - entries[i].box.area();
+        if (enlargement < bestEnlargement || (enlargement == bestEnlargement && entries[i].box.area() < bestArea)) {
+          best = i;
+          bestEnlargement = enlargement;
+          bestArea = entries[i].box.area();
+        }
+      }
+      node = entries[best].child;
+    }
+    nodes_[node].entries.push_back(entry);
+
+    while (true) {
+      size_t sibling = kNoNode;
+      if (nodes_[node].entries.size() > kMaxEntries) {
+        sibling = split(node);
+      }
+      const size_t parent = nodes_[node].parent;
+      if (parent == kNoNode) {
+        if (sibling != kNoNode) { //the root splits: the tree grows by one level
+          const size_t newRoot = allocateNode(false);
+          nodes_[newRoot].entries = {Entry{nodeBox(node), node, nullptr}, Entry{nodeBox(sibling), sibling, nullptr}};
+          nodes_[node].parent = nodes_[sibling].parent = newRoot;
+          root_ = newRoot;
+        }
+        return;
+      }
+      updateParentBox(node);
+      if (sibling != kNoNode) {
+        nodes_[parent].entries.push_back(Entry{nodeBox(sibling), sibling, nullptr});
+        nodes_[sibling].parent = parent;
+      }
+      node = parent;
+    }
+  }
+
+  //quadratic split: the pair wasting the most area seeds two groups, the rest go where they enlarge the box least
+  size_t split(size_t node) {
+    std::vector<Entry> entries = std::move(nodes_[node].entries);
+    size_t seedA = 0;
+    size_t seedB = 1;
+    Real worstWaste = -std::numeric_limits<Real>::infinity();
+    for (size_t i = 0; i < entries.size(); ++i) {
+      for (size_t j = i + 1; j < entries.size(); ++j) {
+        BoundingBox merged = entries[i].box;
+        merged.extend(entries[j].box);
+        const Real waste = merged.area() - entries[i].box.area() - entries[j].box.area();
+        if (waste > worstWaste) {
+          worstWaste = waste;
+          seedA = i;
+          seedB = j;
+        }
+      }
+    }
+    const size_t sibling = allocateNode(nodes_[node].isLeaf);
+    std::vector<Entry>& groupA = nodes_[node].entries;
+    std::vector<Entry>& groupB = nodes_[sibling].entries;
+    groupA = {entries[seedA]};
+    groupB = {entries[seedB]};
+    BoundingBox boxA = entries[seedA].box;
+    BoundingBox boxB = entries[seedB].box;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (i == seedA || i == seedB) {
+        continue;
+      }
+      const size_t remaining = entries.size() - i - (i < seedB) - (i < seedA);
+      bool toA;
+      if (groupA.size() + remaining <= kMinEntries) {
+        toA = true;
+      } else if (groupB.size() + remaining <= kMinEntries) {
+        toA = false;
+      } else {
+        BoundingBox mergedA = boxA;
+        mergedA.extend(entries[i].box);
+        BoundingBox mergedB = boxB;
+        mergedB.extend(entries[i].box);
+        const Real growthA = mergedA.area() - boxA.area();
+        const Real growthB = mergedB.area() - boxB.area();
+        toA = growthA < growthB || (growthA == growthB && groupA.size() <= groupB.size());
+      }
+      (toA ? groupA : groupB).push_back(entries[i]);
+      (toA ? boxA : boxB).extend(entries[i].box);
+    }
+    if (!nodes_[sibling].isLeaf) {
+      for (const Entry& entry : groupB) {
+        nodes_[entry.child].parent = sibling;
+      }
+    }
+    return sibling;
+  }
+
+  void updateParentBox(size_t node) {
+    for (Entry& entry : nodes_[nodes_[node].parent].entries) {
+      if (entry.child == node) {
+        entry.box = nodeBox(node);
+        return;
+      }
+    }
+  }
+
+  bool findLeaf(size_t node, const Shape* shape, const BoundingBox& box, size_t& leaf, size_t& position) const {
+    const std::vector<Entry>& entries = nodes_[node].entries;
+    for (size_t i = 0; i < entries.size(); ++i) {
+      if (nodes_[node].isLeaf && entries[i].shape == shape) {
+        leaf = node;
+        position = i;
+        return true;
+      }
+      if (!nodes_[node].isLeaf && entries[i].box.contains(box) && findLeaf(entries[i].child, shape, box, leaf, position)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  void collectShapes(size_t node, std::vector<Shape*>& shapes) { //frees the whole subtree
+    for (const Entry& entry : nodes_[node].entries) {
+      if (nodes_[node].isLeaf) {
+        shapes.push_back(entry.shape);
+      } else {
+        collectShapes(entry.child, shapes);
+      }
+    }
+    nodes_[node].entries.clear();
+    freeNodes_.push_back(node);
+  }
 
+  //underfull nodes are dissolved and their shapes inserted again, which keeps every leaf at the same depth
+  void condenseTree(size_t node) {
+    std::vector<Shape*> orphans;
+    while (nodes_[node].parent != kNoNode) {
+      const size_t parent = nodes_[node].parent;
+      if (nodes_[node].entries.size() < kMinEntries) {
+        std::vector<Entry>& siblings = nodes_[parent].entries;
+        siblings.erase(std::find_if(siblings.begin(), siblings.end(), [&](const Entry& entry) { return entry.child == node; }));
+        collectShapes(node, orphans);
+      } else {
+        updateParentBox(node);
+      }
+      node = parent;
+    }
+    while (!nodes_[root_].isLeaf && nodes_[root_].entries.size() == 1) { //a root with a single child is redundant
+      const size_t child = nodes_[root_].entries.front().child;
+      freeNodes_.push_back(root_);
+      root_ = child;
+      nodes_[root_].parent = kNoNode;
+    }
+    if (nodes_[root_].entries.empty()) {
+      nodes_[root_].isLeaf = true;
+    }
+    for (Shape* shape : orphans) {
+      insertEntry(Entry{shape->boundingBox(), 0, shape});
+    }
+  }
+};
 
+using RTree = BasicRTree<fType>;
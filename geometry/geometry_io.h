@@ -0,0 +1,580 @@
+#pragma once
+#include <charconv>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "geometry.h"
+
+//Streaming point and polygon files. Text: whitespace separated numbers, a point is "x y", a polygon is its vertex count
+//followed by the coordinates, '#' starts a comment up to the end of the line. Binary: a versioned header followed by the
+//same records as fixed-width little-endian words. Readers work on a mapped file or on chunks of a stream, parse with
+//std::from_chars and give every polygon a vertex buffer of its final size; writers format with std::to_chars into a
+//chunk that goes to the stream only when full, so nothing flushes per line
+namespace GeometryIO {
+
+inline constexpr char kMagic[4] = {'G', 'E', 'O', 'M'};
+inline constexpr uint16_t kVersion = 1;
+inline constexpr size_t kChunkSize = 1 << 16;
+inline constexpr size_t kMaxTokenLength = 128; //a longer number is rejected as malformed
+inline constexpr uint64_t kMaxReservedVertices = 1 << 24; //a corrupt count cannot allocate more up front, longer polygons grow
+
+enum class RecordKind : uint8_t {
+  Points = 1,
+  Polygons = 2,
+};
+
+enum class CoordinateKind : uint8_t {
+  Float32 = 1,
+  Float64 = 2,
+  Int32 = 3,
+  Int64 = 4,
+};
+
+enum class Format {
+  Text,
+  Binary,
+};
+
+template<typename T>
+struct CoordinateCodec;
+
+template<typename T, typename Word, CoordinateKind Kind>
+struct WordCodec { //a coordinate stored as the bits of one unsigned word
+  static_assert(sizeof(T) == sizeof(Word));
+  static constexpr CoordinateKind kKind = Kind;
+  static constexpr size_t kWidth = sizeof(Word);
+
+  static void encode(T value, unsigned char* bytes) {
+    Word word = 0;
+    std::memcpy(&word, &value, sizeof(word));
+    for (size_t i = 0; i < sizeof(Word); ++i) {
+      bytes[i] = static_cast<unsigned char>((word >> (8 * i)) & 0xFF);
+    }
+  }
+
+  static T decode(const unsigned char* bytes) {
+    Word word = 0;
+    for (size_t i = 0; i < sizeof(Word); ++i) {
+      word = static_cast<Word>(word | static_cast<Word>(static_cast<Word>(bytes[i]) << (8 * i)));
+    }
+    T value;
+    std::memcpy(&value, &word, sizeof(word));
+    return value;
+  }
+};
+
+template<>
+struct CoordinateCodec<float> : WordCodec<float, uint32_t, CoordinateKind::Float32> {};
+
+template<>
+struct CoordinateCodec<double> : WordCodec<double, uint64_t, CoordinateKind::Float64> {};
+
+template<>
+struct CoordinateCodec<int32_t> : WordCodec<int32_t, uint32_t, CoordinateKind::Int32> {};
+
+template<>
+struct CoordinateCodec<int64_t> : WordCodec<int64_t, uint64_t, CoordinateKind::Int64> {};
+
+class MappedFile { //read-only memory mapping of a whole file
+public:
+  explicit MappedFile(const std::string& path) {
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+      return;
+    }
+    struct stat status{};
+    if (::fstat(descriptor, &status) == 0) {
+      isOpen_ = status.st_size == 0; //an empty file has nothing to map
+      if (status.st_size > 0) {
+        void* mapping = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+        if (mapping != MAP_FAILED) {
+          data_ = static_cast<const unsigned char*>(mapping);
+          size_ = static_cast<size_t>(status.st_size);
+          isOpen_ = true;
+          ::madvise(mapping, size_, MADV_SEQUENTIAL);
+        }
+      }
+    }
+    ::close(descriptor); //the mapping outlives the descriptor
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<unsigned char*>(data_), size_);
+    }
+  }
+
+  bool isOpen() const {
+    return isOpen_;
+  }
+
+  const unsigned char* data() const {
+    return data_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+private:
+  const unsigned char* data_ = nullptr;
+  size_t size_ = 0;
+  bool isOpen_ = false;
+};
+
+//input bytes either all in memory (a mapped file or a buffer) or read from a stream chunk by chunk on demand
+class ByteSource {
+public:
+  ByteSource(const unsigned char* begin, const unsigned char* end)
+  : cursor_(begin)
+  , end_(end)
+  {}
+
+  explicit ByteSource(std::istream& in, size_t chunkSize = kChunkSize)
+  : in_(&in)
+  , buffer_(chunkSize)
+  , cursor_(buffer_.data())
+  , end_(buffer_.data())
+  {}
+
+  ByteSource(const ByteSource&) = delete;
+  ByteSource& operator=(const ByteSource&) = delete;
+
+  const unsigned char* cursor() const {
+    return cursor_;
+  }
+
+  const unsigned char* end() const {
+    return end_;
+  }
+
+  size_t available() const {
+    return static_cast<size_t>(end_ - cursor_);
+  }
+
+  void advance(size_t count) {
+    cursor_ += count;
+  }
+
+  void moveTo(const unsigned char* position) {
+    cursor_ = position;
+  }
+
+  bool request(size_t count) { //at least count bytes ahead of the cursor; false if the input ends first
+    return available() >= count || refill(count);
+  }
+
+private:
+  std::istream* in_ = nullptr;
+  std::vector<unsigned char> buffer_;
+  const unsigned char* cursor_;
+  const unsigned char* end_;
+
+  bool refill(size_t count) {
+    if (in_ == nullptr || !*in_) {
+      return available() >= count;
+    }
+    const size_t kept = available();
+    std::memmove(buffer_.data(), cursor_, kept);
+    if (buffer_.size() < count) {
+      buffer_.resize(count);
+    }
+    size_t size = kept;
+    while (size < count && *in_) { //one read usually fills the chunk, several if the stream returns short reads
+      in_->read(reinterpret_cast<char*>(buffer_.data() + size), static_cast<std::streamsize>(buffer_.size() - size));
+      size += static_cast<size_t>(in_->gcount());
+    }
+    cursor_ = buffer_.data();
+    end_ = buffer_.data() + size;
+    return size >= count;
+  }
+};
+
+class ByteSink { //output collected in one chunk and written to the stream when it fills up or on flush
+public:
+  explicit ByteSink(std::ostream& out, size_t chunkSize = kChunkSize)
+  : out_(out)
+  , buffer_(chunkSize)
+  {}
+
+  ByteSink(const ByteSink&) = delete;
+  ByteSink& operator=(const ByteSink&) = delete;
+
+  ~ByteSink() {
+    flush();
+  }
+
+  unsigned char* reserve(size_t count) { //room for count bytes; commit marks how many were written
+    if (size_ + count > buffer_.size()) {
+      flush();
+      if (count > buffer_.size()) {
+        buffer_.resize(count);
+      }
+    }
+    return buffer_.data() + size_;
+  }
+
+  void commit(const unsigned char* end) {
+    size_ = static_cast<size_t>(end - buffer_.data());
+  }
+
+  void write(const void* data, size_t count) {
+    unsigned char* target = reserve(count);
+    std::memcpy(target, data, count);
+    commit(target + count);
+  }
+
+  bool flush() {
+    out_.write(reinterpret_cast<const char*>(buffer_.data()), static_cast<std::streamsize>(size_));
+    size_ = 0;
+    return static_cast<bool>(out_);
+  }
+
+private:
+  std::ostream& out_;
+  std::vector<unsigned char> buffer_;
+  size_t size_ = 0;
+};
+
+struct Header { //magic, version, record kind, coordinate kind; the records follow up to the end of the file
+  static constexpr size_t kSize = sizeof(kMagic) + sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint8_t);
+
+  RecordKind records = RecordKind::Polygons;
+  CoordinateKind coordinates = CoordinateKind::Float64;
+
+  void write(ByteSink& sink) const {
+    const unsigned char bytes[kSize] = {kMagic[0], kMagic[1], kMagic[2], kMagic[3], kVersion & 0xFF, kVersion >> 8,
+                                        static_cast<uint8_t>(records), static_cast<uint8_t>(coordinates)};
+    sink.write(bytes, kSize);
+  }
+
+  bool read(ByteSource& source) {
+    if (!source.request(kSize) || std::memcmp(source.cursor(), kMagic, sizeof(kMagic)) != 0) {
+      return false;
+    }
+    const unsigned char* bytes = source.cursor();
+    const uint16_t version = static_cast<uint16_t>(bytes[4] | (bytes[5] << 8));
+    records = static_cast<RecordKind>(bytes[6]);
+    coordinates = static_cast<CoordinateKind>(bytes[7]);
+    source.advance(kSize);
+    return version == kVersion;
+  }
+
+  friend bool operator==(const Header& lhs, const Header& rhs) = default;
+};
+
+inline bool isBinary(const unsigned char* begin, const unsigned char* end) {
+  return static_cast<size_t>(end - begin) >= sizeof(kMagic) && std::memcmp(begin, kMagic, sizeof(kMagic)) == 0;
+}
+
+template<typename T>
+class TextReader {
+public:
+  using Point = BasicPoint<T>;
+
+  explicit TextReader(ByteSource& source)
+  : source_(source)
+  {}
+
+  bool malformed() const { //a reader that returned false stopped at a bad token rather than at the end of the input
+    return malformed_;
+  }
+
+  bool readPoint(Point& point) {
+    return parse(point.x) && parse(point.y, true);
+  }
+
+  bool readPolygon(BasicPolygon<T>& polygon) {
+    uint64_t count = 0;
+    if (!parse(count)) {
+      return false;
+    }
+    std::vector<Point> vertices;
+    vertices.reserve(std::min(count, kMaxReservedVertices));
+    for (uint64_t i = 0; i < count; ++i) {
+      Point& vertex = vertices.emplace_back();
+      if (!parse(vertex.x, true) || !parse(vertex.y, true)) {
+        return false;
+      }
+    }
+    polygon = BasicPolygon<T>(std::move(vertices));
+    return true;
+  }
+
+private:
+  ByteSource& source_;
+  bool malformed_ = false;
+
+  bool skipSpace() { //false at the end of the input
+    while (source_.request(1)) {
+      const unsigned char* cursor = source_.cursor();
+      const unsigned char* end = source_.end();
+      while (cursor != end && (*cursor == ' ' || *cursor == '\n' || *cursor == '\t' || *cursor == '\r')) {
+        ++cursor;
+      }
+      source_.moveTo(cursor);
+      if (cursor == end) {
+        continue;
+      }
+      if (*cursor != '#') {
+        return true;
+      }
+      while (source_.request(1)) { //a comment runs to the end of the line
+        const unsigned char* newline = static_cast<const unsigned char*>(std::memchr(source_.cursor(), '\n', source_.available()));
+        source_.moveTo(newline != nullptr ? newline : source_.end());
+        if (newline != nullptr) {
+          break;
+        }
+      }
+    }
+    return false;
+  }
+
+  template<typename Number>
+  bool parse(Number& value, bool required = false) { //the end of the input is malformed inside a record
+    if (!skipSpace()) {
+      malformed_ = malformed_ || required;
+      return false;
+    }
+    const bool isLast = !source_.request(kMaxTokenLength); //fewer bytes are left than a token may take
+    const char* begin = reinterpret_cast<const char*>(source_.cursor());
+    const char* end = reinterpret_cast<const char*>(source_.end());
+    const auto [stop, error] = std::from_chars(begin, end, value);
+    const bool delimited = stop == end ? isLast : *stop == ' ' || *stop == '\n' || *stop == '\t' || *stop == '\r' || *stop == '#';
+    if (error != std::errc() || !delimited) {
+      malformed_ = true;
+      return false;
+    }
+    source_.advance(static_cast<size_t>(stop - begin));
+    return true;
+  }
+};
+
+template<typename T>
+class BinaryReader {
+public:
+  using Point = BasicPoint<T>;
+  using Codec = CoordinateCodec<T>;
+
+  explicit BinaryReader(ByteSource& source, RecordKind records)
+  : source_(source)
+  {
+    Header header;
+    malformed_ = !header.read(source_) || !(header == Header{records, Codec::kKind});
+  }
+
+  bool malformed() const {
+    return malformed_;
+  }
+
+  bool readPoint(Point& point) {
+    if (malformed_ || !source_.request(2 * Codec::kWidth)) {
+      malformed_ = malformed_ || source_.available() != 0;
+      return false;
+    }
+    const unsigned char* bytes = source_.cursor();
+    point = Point(Codec::decode(bytes), Codec::decode(bytes + Codec::kWidth));
+    source_.advance(2 * Codec::kWidth);
+    return true;
+  }
+
+  bool readPolygon(BasicPolygon<T>& polygon) { //a uint64 vertex count, then the coordinates
+    if (malformed_ || !source_.request(sizeof(uint64_t))) {
+      malformed_ = malformed_ || source_.available() != 0;
+      return false;
+    }
+    uint64_t count = 0;
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+      count |= static_cast<uint64_t>(source_.cursor()[i]) << (8 * i);
+    }
+    source_.advance(sizeof(uint64_t));
+    std::vector<Point> vertices;
+    vertices.reserve(std::min(count, kMaxReservedVertices));
+    for (uint64_t done = 0; done < count;) { //decoded in runs of whatever the buffer holds
+      if (!source_.request(2 * Codec::kWidth)) {
+        malformed_ = true;
+        return false;
+      }
+      const size_t run = static_cast<size_t>(std::min<uint64_t>(count - done, source_.available() / (2 * Codec::kWidth)));
+      const unsigned char* bytes = source_.cursor();
+      for (size_t i = 0; i < run; ++i, bytes += 2 * Codec::kWidth) {
+        vertices.emplace_back(Codec::decode(bytes), Codec::decode(bytes + Codec::kWidth));
+      }
+      source_.moveTo(bytes);
+      done += run;
+    }
+    polygon = BasicPolygon<T>(std::move(vertices));
+    return true;
+  }
+
+private:
+  ByteSource& source_;
+  bool malformed_ = false;
+};
+
+template<typename T>
+class TextWriter {
+public:
+  explicit TextWriter(ByteSink& sink)
+  : sink_(sink)
+  {}
+
+  void writePoint(const BasicPoint<T>& point) {
+    unsigned char* cursor = sink_.reserve(2 * kMaxTokenLength);
+    cursor = format(format(cursor, point.x, ' '), point.y, '\n');
+    sink_.commit(cursor);
+  }
+
+  void writePolygon(const BasicPolygon<T>& polygon) { //the count and one vertex per line
+    const std::vector<BasicPoint<T>>& vertices = polygon.vertices();
+    unsigned char* cursor = sink_.reserve(kMaxTokenLength);
+    sink_.commit(format(cursor, static_cast<uint64_t>(vertices.size()), '\n'));
+    for (const BasicPoint<T>& vertex : vertices) {
+      writePoint(vertex);
+    }
+  }
+
+private:
+  ByteSink& sink_;
+
+  template<typename Number>
+  static unsigned char* format(unsigned char* cursor, Number value, char delimiter) { //shortest form that reads back exactly
+    char* end = std::to_chars(reinterpret_cast<char*>(cursor), reinterpret_cast<char*>(cursor) + kMaxTokenLength - 1, value).ptr;
+    *end++ = delimiter;
+    return reinterpret_cast<unsigned char*>(end);
+  }
+};
+
+template<typename T>
+class BinaryWriter {
+public:
+  using Codec = CoordinateCodec<T>;
+
+  BinaryWriter(ByteSink& sink, RecordKind records)
+  : sink_(sink)
+  {
+    Header{records, Codec::kKind}.write(sink_);
+  }
+
+  void writePoint(const BasicPoint<T>& point) {
+    unsigned char* bytes = sink_.reserve(2 * Codec::kWidth);
+    Codec::encode(point.x, bytes);
+    Codec::encode(point.y, bytes + Codec::kWidth);
+    sink_.commit(bytes + 2 * Codec::kWidth);
+  }
+
+  void writePolygon(const BasicPolygon<T>& polygon) {
+    const std::vector<BasicPoint<T>>& vertices = polygon.vertices();
+    unsigned char* bytes = sink_.reserve(sizeof(uint64_t));
+    const uint64_t count = vertices.size();
+    for (size_t i = 0; i < sizeof(uint64_t); ++i) {
+      bytes[i] = static_cast<unsigned char>((count >> (8 * i)) & 0xFF);
+    }
+    sink_.commit(bytes + sizeof(uint64_t));
+    for (const BasicPoint<T>& vertex : vertices) {
+      writePoint(vertex);
+    }
+  }
+
+private:
+  ByteSink& sink_;
+};
+
+//every record of one kind from a source; binary input is recognized by its magic. False if the input is malformed,
+//the records read before the error are kept
+template<typename T, typename Record, typename Read>
+bool readRecords(ByteSource& source, RecordKind records, std::vector<Record>& result, Read read) {
+  Record record;
+  if (source.request(sizeof(kMagic)) && isBinary(source.cursor(), source.end())) {
+    BinaryReader<T> reader(source, records);
+    while (read(reader, record)) {
+      result.push_back(std::move(record));
+    }
+    return !reader.malformed();
+  }
+  TextReader<T> reader(source);
+  while (read(reader, record)) {
+    result.push_back(std::move(record));
+  }
+  return !reader.malformed();
+}
+
+template<typename T>
+bool readPoints(ByteSource& source, std::vector<BasicPoint<T>>& points) {
+  return readRecords<T>(source, RecordKind::Points, points, [](auto& reader, BasicPoint<T>& point) { return reader.readPoint(point); });
+}
+
+template<typename T>
+bool readPolygons(ByteSource& source, std::vector<BasicPolygon<T>>& polygons) {
+  return readRecords<T>(source, RecordKind::Polygons, polygons, [](auto& reader, BasicPolygon<T>& polygon) { return reader.readPolygon(polygon); });
+}
+
+template<typename T>
+bool writePoints(std::ostream& out, std::span<const BasicPoint<T>> points, Format format) {
+  ByteSink sink(out);
+  if (format == Format::Binary) {
+    BinaryWriter<T> writer(sink, RecordKind::Points);
+    for (const BasicPoint<T>& point : points) {
+      writer.writePoint(point);
+    }
+  } else {
+    TextWriter<T> writer(sink);
+    for (const BasicPoint<T>& point : points) {
+      writer.writePoint(point);
+    }
+  }
+  return sink.flush();
+}
+
+template<typename T>
+bool writePolygons(std::ostream& out, std::span<const BasicPolygon<T>> polygons, Format format) {
+  ByteSink sink(out);
+  if (format == Format::Binary) {
+    BinaryWriter<T> writer(sink, RecordKind::Polygons);
+    for (const BasicPolygon<T>& polygon : polygons) {
+      writer.writePolygon(polygon);
+    }
+  } else {
+    TextWriter<T> writer(sink);
+    for (const BasicPolygon<T>& polygon : polygons) {
+      writer.writePolygon(polygon);
+    }
+  }
+  return sink.flush();
+}
+
+template<typename T>
+bool savePoints(const std::string& path, std::span<const BasicPoint<T>> points, Format format) {
+  std::ofstream out(path, std::ios::binary);
+  return writePoints(out, points, format);
+}
+
+template<typename T>
+bool savePolygons(const std::string& path, std::span<const BasicPolygon<T>> polygons, Format format) {
+  std::ofstream out(path, std::ios::binary);
+  return writePolygons(out, polygons, format);
+}
+
+template<typename T>
+bool loadPoints(const std::string& path, std::vector<BasicPoint<T>>& points) { //parses straight from the mapped file
+  const MappedFile file(path);
+  ByteSource source(file.data(), file.data() + file.size());
+  return file.isOpen() && readPoints(source, points);
+}
+
+template<typename T>
+bool loadPolygons(const std::string& path, std::vector<BasicPolygon<T>>& polygons) {
+  const MappedFile file(path);
+  ByteSource source(file.data(), file.data() + file.size());
+  return file.isOpen() && readPolygons(source, polygons);
+}
+
+}
@@ -0,0 +1,735 @@
+#include "../biginteger_rational/biginteger.h"
+#include "geometry.h"
+#include "geometry_io.h"
+#include <algorithm>
+#include <cassert>
+#include <cmath>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <memory>
+#include <random>
+#include <sstream>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+using namespace std;
+
+void testPolygonArea() {
+    // Площадь по формуле шнурования
+    Polygon square(Point(0, 0), Point(2, 0), Point(2, 2), Point(0, 2));
+    assert(square.area() == 4);
+    assert(square.toVertexArray().signedArea() == 4);
+
+    // Обход по часовой стрелке: площадь та же, ориентированная площадь отрицательна
+    Polygon clockwise(Point(0, 2), Point(2, 2), Point(2, 0), Point(0, 0));
+    assert(clockwise.area() == 4);
+    assert(clockwise.toVertexArray().signedArea() == -4);
+
+    // Целые координаты считаются точно
+    BasicPolygon<int64_t> triangle(BasicPoint<int64_t>(0, 0), BasicPoint<int64_t>(3, 0), BasicPoint<int64_t>(0, 1));
+    assert(triangle.area() == 1.5);
+}
+
+void testPolygonAreaFarFromOrigin() {
+    // Четырёхугольник, сдвинутый на 1e8: слагаемые порядка 1e16 не должны съедать площадь порядка единицы
+    const vector<Point> quad = {Point(0.1, 0.2), Point(1.7, 0.3), Point(1.9, 1.4), Point(0.3, 1.3)};
+    const double expected = Polygon(quad).area();
+    for (double offset : {1e6, 1e8, -1e8}) {
+        vector<Point> shifted;
+        for (const Point& point : quad) {
+            shifted.push_back(Point(point.x + offset, point.y + offset));
+        }
+        assert(fabs(Polygon(shifted).area() - expected) < 1e-6);
+        assert(fabs(VertexArray(shifted).area() - expected) < 1e-6);
+    }
+
+    // Много вершин, чтобы сработала и векторная ветка signedArea
+    vector<Point> circle;
+    for (int i = 0; i < 1000; ++i) {
+        const double angle = 2 * M_PI * i / 1000;
+        circle.push_back(Point(1e8 + cos(angle), 1e8 + sin(angle)));
+    }
+    assert(fabs(VertexArray(circle).area() - M_PI) < 1e-4);
+    assert(fabs(Polygon(circle).area() - M_PI) < 1e-4);
+}
+
+void testOrientation() {
+    // Точки у (0.5, 0.5) с шагом в полединицы последнего разряда: знак определителя виден только при точном счёте
+    const double ulp = ldexp(1.0, -53);
+    for (int i = 0; i < 16; ++i) {
+        for (int j = 0; j < 16; ++j) {
+            const Point a(0.5 + i * ulp, 0.5 + j * ulp);
+            const int expected = (j > i) - (j < i);
+            assert(orientation(a, Point(12, 12), Point(24, 24)) == expected);
+            assert(Predicates::orientation(a, Point(12, 12), Point(24, 24)) == expected);
+        }
+    }
+}
+
+void testPreparedPolygonContainsHull() {
+    // Вершины выпуклой оболочки и исходные точки лежат в ней; проверка не зависит от сжатия в FMA (-mfma)
+    mt19937 generator(5);
+    uniform_real_distribution<double> coordinate(-1e3, 1e3);
+    for (int test = 0; test < 100; ++test) {
+        vector<Point> points;
+        for (int i = 0; i < 200; ++i) {
+            points.push_back(Point(coordinate(generator) * 0.731 + 1e4, coordinate(generator) * 1.37 - 3e3));
+        }
+        const Polygon hull = convexHull(points);
+        const PreparedPolygon prepared(hull);
+        assert(prepared.isConvex());
+        for (const Point& vertex : hull.vertices()) {
+            assert(prepared.contains(vertex));
+        }
+        assert(prepared.countContained(points) == points.size());
+    }
+}
+
+vector<Point> randomStar(mt19937& generator, Point center, size_t count, double radius) { //simple, generally non-convex
+    uniform_real_distribution<double> scale(0.3, 1.0);
+    vector<Point> points;
+    for (size_t i = 0; i < count; ++i) {
+        const double angle = 2 * M_PI * static_cast<double>(i) / static_cast<double>(count);
+        const double length = radius * scale(generator);
+        points.push_back(Point(center.x + length * cos(angle), center.y + length * sin(angle)));
+    }
+    return points;
+}
+
+template<typename T>
+T totalDoubledArea(const vector<BasicPolygon<T>>& contours) { //outer contours count positive, holes negative
+    T result = 0;
+    for (const BasicPolygon<T>& contour : contours) {
+        result += doubledSignedArea<T>(contour.vertices());
+    }
+    return result;
+}
+
+void testConvexHull() {
+    // Оболочка выпукла, обходится против часовой стрелки, содержит все точки; точки на сторонах не входят
+    mt19937 generator(46);
+    uniform_real_distribution<double> coordinate(-100, 100);
+    for (int test = 0; test < 50; ++test) {
+        vector<Point> points;
+        for (int i = 0; i < 100; ++i) {
+            points.push_back(Point(coordinate(generator), coordinate(generator)));
+        }
+        const Polygon hull = convexHull(points);
+        assert(hull.isConvex() && doubledSignedArea<fType>(hull.vertices()) > 0);
+        for (const Point& point : points) {
+            assert(hull.containsPoint(point));
+        }
+    }
+    vector<BasicPoint<int64_t>> grid;
+    for (int64_t x = 0; x <= 4; ++x) {
+        for (int64_t y = 0; y <= 4; ++y) {
+            grid.push_back(BasicPoint<int64_t>(x, y));
+        }
+    }
+    assert(convexHull(grid).verticesCount() == 4 && convexHull(grid).area() == 16);
+    assert(convexHull<fType>({Point(0, 0), Point(1, 1), Point(2, 2)}).verticesCount() == 2);
+}
+
+void testMinkowskiSum() {
+    // Сумма Минковского совпадает с оболочкой попарных сумм вершин, на целых координатах — точно
+    mt19937 generator(47);
+    uniform_int_distribution<int64_t> coordinate(-1000000, 1000000);
+    using IntPoint = BasicPoint<int64_t>;
+    for (int test = 0; test < 50; ++test) {
+        vector<IntPoint> left;
+        vector<IntPoint> right;
+        for (int i = 0; i < 20; ++i) {
+            left.push_back(IntPoint(coordinate(generator), coordinate(generator)));
+            right.push_back(IntPoint(coordinate(generator) / 10, coordinate(generator) / 10));
+        }
+        const BasicPolygon<int64_t> lhs = convexHull(left);
+        const BasicPolygon<int64_t> rhs = convexHull(right);
+        vector<IntPoint> sums;
+        for (const IntPoint& a : lhs.vertices()) {
+            for (const IntPoint& b : rhs.vertices()) {
+                sums.push_back(a + b);
+            }
+        }
+        const BasicPolygon<int64_t> sum = minkowskiSum(lhs, rhs);
+        const BasicPolygon<int64_t> expected = convexHull(sums);
+        assert(sum.verticesCount() == expected.verticesCount());
+        assert(doubledSignedArea<int64_t>(sum.vertices()) == doubledSignedArea<int64_t>(expected.vertices()));
+        for (const IntPoint& vertex : sum.vertices()) {
+            assert(expected.containsPoint(vertex));
+        }
+    }
+    // Вырожденный операнд: отрезок
+    const Polygon square(Point(0, 0), Point(1, 0), Point(1, 1), Point(0, 1));
+    const Polygon segment(Point(0, 0), Point(2, 0));
+    assert(fabs(minkowskiSum(square, segment).area() - 3) < 1e-12);
+}
+
+void testConvexIntersection() {
+    // Пересечение выпуклых многоугольников совпадает с результатом PolygonClipper
+    mt19937 generator(48);
+    uniform_real_distribution<double> coordinate(-100, 100);
+    for (int test = 0; test < 50; ++test) {
+        vector<Point> left;
+        vector<Point> right;
+        for (int i = 0; i < 30; ++i) {
+            left.push_back(Point(coordinate(generator), coordinate(generator)));
+            right.push_back(Point(coordinate(generator) + 50, coordinate(generator)));
+        }
+        const Polygon lhs = convexHull(left);
+        const Polygon rhs = convexHull(right);
+        const Polygon intersection = convexIntersection(lhs, rhs);
+        const vector<Polygon> clipped = PolygonClipper::clip(lhs, rhs, PolygonClipper::Operation::Intersection);
+        assert(clipped.size() <= 1);
+        const double clippedArea = clipped.empty() ? 0 : clipped[0].area();
+        assert(fabs(intersection.area() - clippedArea) < 1e-7);
+        assert(intersection.area() <= min(lhs.area(), rhs.area()) + 1e-9);
+    }
+    // Непересекающиеся — пустой многоугольник; целые координаты — точно
+    const Polygon far(Point(10, 10), Point(11, 10), Point(11, 11));
+    const Polygon square(Point(0, 0), Point(1, 0), Point(1, 1), Point(0, 1));
+    assert(convexIntersection(square, far).verticesCount() == 0);
+    using IntPoint = BasicPoint<int64_t>;
+    const BasicPolygon<int64_t> a(IntPoint(0, 0), IntPoint(4, 0), IntPoint(4, 4), IntPoint(0, 4));
+    const BasicPolygon<int64_t> b(IntPoint(2, 2), IntPoint(6, 2), IntPoint(6, 6), IntPoint(2, 6));
+    assert(convexIntersection(a, b).area() == 4);
+}
+
+void testPolygonClipper() {
+    // Тождества площадей: |A ∪ B| = |A| + |B| - |A ∩ B|, |A \ B| = |A| - |A ∩ B| для невыпуклых многоугольников
+    mt19937 generator(49);
+    using Operation = PolygonClipper::Operation;
+    for (int test = 0; test < 50; ++test) {
+        const Polygon lhs(randomStar(generator, Point(0, 0), 40, 10));
+        const Polygon rhs(randomStar(generator, Point(3, 2), 30, 8));
+        const double intersection = totalDoubledArea(PolygonClipper::clip(lhs, rhs, Operation::Intersection)) / 2;
+        const double united = totalDoubledArea(PolygonClipper::clip(lhs, rhs, Operation::Union)) / 2;
+        const double difference = totalDoubledArea(PolygonClipper::clip(lhs, rhs, Operation::Difference)) / 2;
+        assert(fabs(united - (lhs.area() + rhs.area() - intersection)) < 1e-8);
+        assert(fabs(difference - (lhs.area() - intersection)) < 1e-8);
+    }
+
+    // Дыра: внешний контур против часовой стрелки, дыра — по часовой
+    const Polygon outer(Point(0, 0), Point(10, 0), Point(10, 10), Point(0, 10));
+    const Polygon inner(Point(3, 3), Point(3, 6), Point(6, 6), Point(6, 3));
+    const vector<Polygon> withHole = PolygonClipper::clip(outer, inner, Operation::Difference);
+    assert(withHole.size() == 2);
+    assert(totalDoubledArea(withHole) == 2 * 91);
+    assert(doubledSignedArea<fType>(withHole[0].vertices()) * doubledSignedArea<fType>(withHole[1].vertices()) < 0);
+
+    // Общая сторона: объединение двух соседних квадратов — один контур
+    const Polygon left(Point(0, 0), Point(1, 0), Point(1, 1), Point(0, 1));
+    const Polygon right(Point(1, 0), Point(2, 0), Point(2, 1), Point(1, 1));
+    const vector<Polygon> united = PolygonClipper::clip(left, right, Operation::Union);
+    assert(united.size() == 1 && united[0].area() == 2);
+    assert(PolygonClipper::clip(left, right, Operation::Intersection).empty());
+    assert(PolygonClipper::clip(left, left, Operation::Difference).empty());
+
+    // Целые и рациональные координаты: точные площади
+    using IntPoint = BasicPoint<int64_t>;
+    const BasicPolygon<int64_t> intOuter(IntPoint(0, 0), IntPoint(6, 0), IntPoint(6, 6), IntPoint(0, 6));
+    const BasicPolygon<int64_t> intTriangle(IntPoint(3, -3), IntPoint(9, 3), IntPoint(3, 9));
+    using IntClipper = BasicPolygonClipper<int64_t>;
+    assert(totalDoubledArea(IntClipper::clip(intOuter, intTriangle, IntClipper::Operation::Intersection)) == 2 * 18);
+    using RationalPoint = BasicPoint<Rational>;
+    const Rational third(BigInteger(1), BigInteger(3));
+    const BasicPolygon<Rational> rationalSquare(RationalPoint(0, 0), RationalPoint(1, 0), RationalPoint(1, 1), RationalPoint(0, 1));
+    const BasicPolygon<Rational> rationalShifted(RationalPoint(third, third), RationalPoint(third + 1, third),
+                                                 RationalPoint(third + 1, third + 1), RationalPoint(third, third + 1));
+    using RationalClipper = BasicPolygonClipper<Rational>;
+    const Rational overlap = totalDoubledArea(RationalClipper::clip(rationalSquare, rationalShifted, RationalClipper::Operation::Intersection));
+    assert(overlap == Rational(BigInteger(8), BigInteger(9)));
+}
+
+vector<unique_ptr<Shape>> randomShapes(mt19937& generator, size_t count) { //circles and triangles scattered over a square
+    uniform_real_distribution<double> coordinate(-1000, 1000);
+    uniform_real_distribution<double> size(0.5, 20);
+    vector<unique_ptr<Shape>> shapes;
+    for (size_t i = 0; i < count; ++i) {
+        const Point corner(coordinate(generator), coordinate(generator));
+        if (i % 2 == 0) {
+            shapes.push_back(make_unique<Circle>(corner, size(generator)));
+        } else {
+            shapes.push_back(make_unique<Triangle>(corner, corner + Point(size(generator), 0), corner + Point(0, size(generator))));
+        }
+    }
+    return shapes;
+}
+
+vector<Shape*> sortedShapes(vector<Shape*> shapes) {
+    sort(shapes.begin(), shapes.end());
+    return shapes;
+}
+
+// Сверяет запросы дерева с полным перебором по множеству live
+void checkRTreeQueries(const RTree& tree, const vector<Shape*>& live, mt19937& generator) {
+    uniform_real_distribution<double> coordinate(-1100, 1100);
+    uniform_real_distribution<double> extent(0, 300);
+    assert(tree.size() == live.size());
+    for (int query = 0; query < 30; ++query) {
+        const Point corner(coordinate(generator), coordinate(generator));
+        const BoundingBox range{corner, corner + Point(extent(generator), extent(generator))};
+        vector<Shape*> expected;
+        for (Shape* shape : live) {
+            if (shape->boundingBox().intersects(range)) {
+                expected.push_back(shape);
+            }
+        }
+        assert(sortedShapes(tree.queryRange(range)) == sortedShapes(expected));
+
+        const Point point(coordinate(generator), coordinate(generator));
+        const size_t count = 10;
+        vector<double> distances;
+        for (Shape* shape : live) {
+            distances.push_back(shape->boundingBox().distance2(point));
+        }
+        sort(distances.begin(), distances.end());
+        distances.resize(min(count, distances.size()));
+        const vector<Shape*> nearest = tree.nearest(point, count);
+        assert(nearest.size() == distances.size());
+        for (size_t i = 0; i < nearest.size(); ++i) { // при равных расстояниях порядок не определён, сравниваем расстояния
+            assert(nearest[i]->boundingBox().distance2(point) == distances[i]);
+        }
+    }
+}
+
+void testRTree() {
+    // Упаковка STR и поштучная вставка дают одинаковые ответы, совпадающие с полным перебором
+    mt19937 generator(44);
+    const vector<unique_ptr<Shape>> owned = randomShapes(generator, 2000);
+    vector<Shape*> live;
+    for (const unique_ptr<Shape>& shape : owned) {
+        live.push_back(shape.get());
+    }
+    RTree packed(live);
+    RTree incremental;
+    for (Shape* shape : live) {
+        incremental.insert(shape);
+    }
+    checkRTreeQueries(packed, live, generator);
+    checkRTreeQueries(incremental, live, generator);
+
+    // Удаление с condenseTree: удаляем по случайным фигурам, пока дерево не опустеет
+    for (RTree* tree : {&packed, &incremental}) {
+        vector<Shape*> remaining = live;
+        shuffle(remaining.begin(), remaining.end(), generator);
+        while (!remaining.empty()) {
+            const size_t batch = min<size_t>(remaining.size(), 250);
+            for (size_t i = 0; i < batch; ++i) {
+                assert(tree->remove(remaining.back()));
+                assert(!tree->remove(remaining.back()));
+                remaining.pop_back();
+            }
+            checkRTreeQueries(*tree, remaining, generator);
+        }
+        assert(tree->queryRange(BoundingBox{Point(-2000, -2000), Point(2000, 2000)}).empty());
+        assert(tree->nearest(Point(0, 0), 5).empty());
+        // После опустошения дерево снова принимает фигуры
+        for (size_t i = 0; i < 100; ++i) {
+            tree->insert(live[i]);
+        }
+        checkRTreeQueries(*tree, vector<Shape*>(live.begin(), live.begin() + 100), generator);
+    }
+}
+
+void testPolygonSignature() {
+    // Сигнатура не меняется при движениях, сдвиге нумерации и зеркальном отражении
+    using Kind = PolygonSignature::Kind;
+    mt19937 generator(45);
+    uniform_real_distribution<double> angle(0, 360);
+    uniform_real_distribution<double> shift(-100, 100);
+    unordered_set<PolygonSignature> congruence;
+    unordered_set<PolygonSignature> similarity;
+    const size_t kShapes = 20;
+    for (size_t shape = 0; shape < kShapes; ++shape) {
+        const Polygon original(randomStar(generator, Point(0, 0), 12, 10));
+        const PolygonSignature congruent(original, Kind::Congruence);
+        const PolygonSignature similar(original, Kind::Similarity);
+
+        Polygon moved = original;
+        moved.rotate(Point(shift(generator), shift(generator)), angle(generator));
+        moved.applyTransform(AffineTransform::translation(Point(shift(generator), shift(generator))));
+        vector<Point> renumbered = original.vertices();
+        rotate(renumbered.begin(), renumbered.begin() + 5, renumbered.end());
+        vector<Point> reversed = original.vertices();
+        reverse(reversed.begin(), reversed.end());
+        Polygon mirrored = original;
+        mirrored.reflect(Line(Point(shift(generator), shift(generator)), Point(shift(generator), shift(generator))));
+        for (const Polygon& copy : {moved, Polygon(renumbered), Polygon(reversed), mirrored}) {
+            assert(original.isCongruentTo(copy));
+            assert(PolygonSignature(copy, Kind::Congruence) == congruent);
+            assert(PolygonSignature(copy, Kind::Similarity) == similar);
+            congruence.insert(PolygonSignature(copy, Kind::Congruence));
+            similarity.insert(PolygonSignature(copy, Kind::Similarity));
+        }
+
+        // Подобный, но не равный: совпадает только сигнатура подобия
+        Polygon scaled = moved;
+        scaled.scale(Point(shift(generator), shift(generator)), 2.5);
+        assert(!original.isCongruentTo(scaled) && original.isSimilarTo(scaled));
+        assert(PolygonSignature(scaled, Kind::Similarity) == similar);
+        assert(!(PolygonSignature(scaled, Kind::Congruence) == congruent));
+        congruence.insert(PolygonSignature(scaled, Kind::Congruence));
+        similarity.insert(PolygonSignature(scaled, Kind::Similarity));
+    }
+    // unordered_set склеивает копии: по классу подобия на фигуру, по два класса равенства (исходный и увеличенный)
+    assert(similarity.size() == kShapes);
+    assert(congruence.size() == 2 * kShapes);
+
+    // Разные виды сигнатур одного многоугольника не равны
+    const Polygon square(Point(0, 0), Point(1, 0), Point(1, 1), Point(0, 1));
+    assert(!(PolygonSignature(square, Kind::Congruence) == PolygonSignature(square, Kind::Similarity)));
+    const Polygon rectangle(Point(0, 0), Point(2, 0), Point(2, 1), Point(0, 1));
+    assert(!(PolygonSignature(square, Kind::Similarity) == PolygonSignature(rectangle, Kind::Similarity)));
+}
+
+bool sameVertices(const vector<Point>& lhs, const vector<Point>& rhs, double eps) {
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (fabs(lhs[i].x - rhs[i].x) > eps || fabs(lhs[i].y - rhs[i].y) > eps) {
+            return false;
+        }
+    }
+    return true;
+}
+
+void testLazyTransform() {
+    // Цепочка поворот/отражение/масштаб даёт то же, что поочерёдное применение к вершинам
+    mt19937 generator(41);
+    const vector<AffineTransform> chain = {
+        AffineTransform::rotation(Point(1, 2), 0.7),
+        AffineTransform::reflection(Line(Point(0, 1), Point(3, -2))),
+        AffineTransform::scaling(Point(-1, 4), 1.5),
+        AffineTransform::reflection(Point(2, 2)),
+        AffineTransform::translation(Point(-5, 3)),
+    };
+    const vector<Point> original = randomStar(generator, Point(0, 0), 16, 10);
+    vector<Point> eager = original;
+    for (const AffineTransform& transform : chain) {
+        for (Point& point : eager) {
+            point = transform.apply(point);
+        }
+    }
+    Polygon lazy(original);
+    lazy.rotate(Point(1, 2), 0.7 * 180 / M_PI);
+    lazy.reflect(Line(Point(0, 1), Point(3, -2)));
+    lazy.scale(Point(-1, 4), 1.5);
+    lazy.reflect(Point(2, 2));
+    lazy.applyTransform(AffineTransform::translation(Point(-5, 3)));
+
+    // Копирование и перемещение многоугольника с неприменённым преобразованием
+    const Polygon copied(lazy);
+    Polygon assigned;
+    assigned = lazy;
+    Polygon source(lazy);
+    const Polygon moved(move(source));
+    Polygon moveAssigned;
+    Polygon moveSource(original);
+    for (const AffineTransform& transform : chain) {
+        moveSource.applyTransform(transform);
+    }
+    moveAssigned = move(moveSource);
+    for (const Polygon* polygon : initializer_list<const Polygon*>{&lazy, &copied, &assigned, &moved, &moveAssigned}) {
+        assert(sameVertices(polygon->vertices(), eager, 1e-9));
+    }
+    // Копия не разделяет последующие преобразования с исходным
+    assigned.applyTransform(AffineTransform::translation(Point(1, 0)));
+    assert(sameVertices(copied.vertices(), eager, 1e-9));
+    assert(fabs(assigned.vertices()[0].x - eager[0].x - 1) < 1e-9);
+
+    // Одновременные константные запросы из нескольких потоков: каждый видит применённое преобразование
+    vector<Polygon> polygons;
+    vector<vector<Point>> expected;
+    for (int i = 0; i < 200; ++i) {
+        polygons.emplace_back(randomStar(generator, Point(i, -i), 8, 5));
+        expected.push_back(polygons.back().vertices());
+        for (const AffineTransform& transform : chain) {
+            polygons.back().applyTransform(transform);
+            for (Point& point : expected.back()) {
+                point = transform.apply(point);
+            }
+        }
+    }
+    atomic<int> mismatches = 0;
+    vector<thread> readers;
+    for (int reader = 0; reader < 8; ++reader) {
+        readers.emplace_back([&, reader] {
+            for (size_t i = 0; i < polygons.size(); ++i) {
+                const size_t index = (i + static_cast<size_t>(reader) * 25) % polygons.size();
+                const Polygon& polygon = polygons[index];
+                if (!sameVertices(polygon.vertices(), expected[index], 1e-9) || fabs(polygon.area() - Polygon(expected[index]).area()) > 1e-9) {
+                    ++mismatches;
+                }
+            }
+        });
+    }
+    for (thread& reader : readers) {
+        reader.join();
+    }
+    assert(mismatches == 0);
+
+    // Эллипс принимает только подобия; отказ не меняет фигуру
+    Ellipse ellipse(Point(0, 0), Point(4, 0), 6);
+    const Ellipse before = ellipse;
+    bool isThrown = false;
+    try {
+        ellipse.applyTransform(AffineTransform(2, 0, 0, 0, 1, 0));
+    } catch (const invalid_argument&) {
+        isThrown = true;
+    }
+    assert(isThrown && ellipse.isEqual(before));
+    ellipse.rotate(Point(1, 1), 90);
+    ellipse.scale(Point(0, 0), 2);
+    assert(fabs(ellipse.area() - 4 * before.area()) < 1e-9);
+}
+
+ShapeCollection randomCollection(mt19937& generator) {
+    uniform_real_distribution<double> coordinate(-50, 50);
+    uniform_real_distribution<double> size(1, 10);
+    ShapeCollection collection;
+    for (int i = 0; i < 30; ++i) {
+        const Point corner(coordinate(generator), coordinate(generator));
+        collection.add(Polygon(randomStar(generator, corner, 7, size(generator))));
+        collection.add(Rectangle(corner, corner + Point(size(generator), size(generator)), 2));
+        collection.add(Square(corner, corner + Point(size(generator), size(generator))));
+        collection.add(Triangle(corner, corner + Point(size(generator), 0), corner + Point(0, size(generator))));
+        collection.add(Ellipse(corner, corner + Point(size(generator), 0), 15));
+        collection.add(Circle(corner, size(generator)));
+    }
+    return collection;
+}
+
+template<typename... Shapes>
+vector<Shape*> shapePointers(BasicShapeCollection<Shapes...>& collection) {
+    vector<Shape*> pointers;
+    collection.forEach([&](Shape& shape) { pointers.push_back(&shape); });
+    return pointers;
+}
+
+void testShapeCollection() {
+    // Пакетные операции совпадают с обходом через Shape* и виртуальные вызовы
+    mt19937 generator(49);
+    ShapeCollection collection = randomCollection(generator);
+    const vector<Shape*> pointers = shapePointers(collection);
+    assert(pointers.size() == collection.size() && collection.size() == 180);
+    double area = 0;
+    double perimeter = 0;
+    for (const Shape* shape : pointers) {
+        area += shape->area();
+        perimeter += shape->perimeter();
+    }
+    assert(fabs(collection.totalArea() - area) < 1e-9 * area);
+    assert(fabs(collection.totalPerimeter() - perimeter) < 1e-9 * perimeter);
+    uniform_real_distribution<double> coordinate(-60, 60);
+    for (int query = 0; query < 200; ++query) {
+        const Point point(coordinate(generator), coordinate(generator));
+        size_t count = 0;
+        for (const Shape* shape : pointers) {
+            count += shape->containsPoint(point) ? 1 : 0;
+        }
+        assert(collection.countContaining(point) == count);
+    }
+
+    // Подобие применяется ко всем фигурам, как поштучный applyTransform
+    ShapeCollection expected = collection;
+    const AffineTransform similarity = AffineTransform::rotation(Point(3, -2), 0.4) * AffineTransform::scaling(Point(0, 0), 1.5);
+    collection.applyTransform(similarity);
+    for (Shape* shape : shapePointers(expected)) {
+        shape->applyTransform(similarity);
+    }
+    const vector<Shape*> transformed = shapePointers(collection);
+    const vector<Shape*> reference = shapePointers(expected);
+    for (size_t i = 0; i < transformed.size(); ++i) {
+        assert(fabs(transformed[i]->area() - reference[i]->area()) < 1e-9 * reference[i]->area());
+        assert(transformed[i]->isCongruentTo(*reference[i]));
+    }
+
+    // Преобразование не подобия отвергается целиком: ни одна фигура не меняется, даже стоящие до эллипсов
+    const ShapeCollection before = collection;
+    bool isThrown = false;
+    try {
+        collection.applyTransform(AffineTransform(2, 0, 0, 0, 1, 0));
+    } catch (const invalid_argument&) {
+        isThrown = true;
+    }
+    assert(isThrown);
+    ShapeCollection unchanged = before;
+    const vector<Shape*> after = shapePointers(collection);
+    const vector<Shape*> original = shapePointers(unchanged);
+    for (size_t i = 0; i < after.size(); ++i) {
+        assert(*after[i] == *original[i]);
+    }
+
+    // Без эллипсов произвольное аффинное преобразование допустимо
+    BasicShapeCollection<Polygon, Triangle> polygons;
+    polygons.add(Polygon(Point(0, 0), Point(1, 0), Point(1, 1), Point(0, 1)));
+    polygons.add(Triangle(Point(0, 0), Point(2, 0), Point(0, 2)));
+    polygons.applyTransform(AffineTransform(2, 0, 0, 0, 1, 0));
+    assert(fabs(polygons.totalArea() - 6) < 1e-12);
+}
+
+template<typename T>
+bool sameBits(const vector<BasicPolygon<T>>& lhs, const vector<BasicPolygon<T>>& rhs) { //bit for bit, not up to kEps
+    if (lhs.size() != rhs.size()) {
+        return false;
+    }
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        const vector<BasicPoint<T>>& left = lhs[i].vertices();
+        const vector<BasicPoint<T>>& right = rhs[i].vertices();
+        if (left.size() != right.size()) {
+            return false;
+        }
+        for (size_t j = 0; j < left.size(); ++j) {
+            if (memcmp(&left[j].x, &right[j].x, sizeof(T)) != 0 || memcmp(&left[j].y, &right[j].y, sizeof(T)) != 0) {
+                return false;
+            }
+        }
+    }
+    return true;
+}
+
+// Читает многоугольники из строки через ByteSource с порциями заданного размера
+template<typename T>
+bool readChunked(const string& data, size_t chunkSize, vector<BasicPolygon<T>>& polygons) {
+    istringstream in(data);
+    GeometryIO::ByteSource source(in, chunkSize);
+    return GeometryIO::readPolygons(source, polygons);
+}
+
+template<typename T>
+string writeToString(const vector<BasicPolygon<T>>& polygons, GeometryIO::Format format) {
+    ostringstream out;
+    const bool isWritten = GeometryIO::writePolygons<T>(out, polygons, format);
+    assert(isWritten);
+    static_cast<void>(isWritten);
+    return out.str();
+}
+
+template<typename T>
+void checkRoundTrip(const vector<BasicPolygon<T>>& polygons) {
+    for (GeometryIO::Format format : {GeometryIO::Format::Text, GeometryIO::Format::Binary}) {
+        const string data = writeToString(polygons, format);
+        for (size_t chunkSize : {size_t(1), size_t(3), size_t(7), size_t(1 << 16)}) {
+            vector<BasicPolygon<T>> read;
+            assert(readChunked(data, chunkSize, read));
+            assert(sameBits(polygons, read));
+        }
+    }
+}
+
+void testGeometryIO() {
+    // Текст и двоичный формат читаются обратно бит в бит при любом размере порции
+    mt19937 generator(50);
+    uniform_real_distribution<double> coordinate(-1e6, 1e6);
+    vector<Polygon> polygons;
+    for (size_t i = 0; i < 60; ++i) {
+        vector<Point> points;
+        for (size_t j = 0; j < i % 7; ++j) {
+            points.push_back(Point(coordinate(generator), ldexp(static_cast<double>(generator()), -40)));
+        }
+        polygons.emplace_back(points);
+    }
+    polygons.emplace_back(vector<Point>{Point(numeric_limits<double>::max(), numeric_limits<double>::lowest()),
+                                        Point(numeric_limits<double>::denorm_min(), -0.0), Point(1e-300, 0.1)});
+    checkRoundTrip(polygons);
+
+    // Крайние значения int64
+    using IntPoint = BasicPoint<int64_t>;
+    const int64_t low = numeric_limits<int64_t>::min();
+    const int64_t high = numeric_limits<int64_t>::max();
+    const vector<BasicPolygon<int64_t>> integers = {
+        BasicPolygon<int64_t>(vector<IntPoint>{IntPoint(low, high), IntPoint(high, low), IntPoint(0, -1)}),
+        BasicPolygon<int64_t>(vector<IntPoint>{IntPoint(high, high), IntPoint(low + 1, low)}),
+    };
+    checkRoundTrip(integers);
+
+    // Комментарии, пробелы и переводы строк в тексте
+    auto checkText = [](const string& text, bool isValid, size_t count) {
+        for (size_t chunkSize : {size_t(1), size_t(3), size_t(1 << 16)}) {
+            vector<Polygon> read;
+            assert(readChunked(text, chunkSize, read) == isValid);
+            assert(read.size() == count);
+        }
+    };
+    checkText("", true, 0);
+    checkText("   \n# only a comment", true, 0);
+    checkText("3 0 0 1 0 0 1 # triangle\n4 0 0 1 0 1 1 0 1\n", true, 2);
+    checkText("3 0 0 1 0 0 1\r\n#c\r\n3 0 0\t1 0 0 1", true, 2);
+    checkText("2 -1.5e3 0.5 7 8", true, 1);
+
+    // Обрезанные и испорченные записи: malformed, прочитанное до ошибки сохраняется
+    checkText("3 0 0 1 0 0", false, 0);
+    checkText("3 0 0 1 0 0 x", false, 0);
+    checkText("3 0 0 1 0 0 1 2", false, 1);
+    checkText("3 0 0 1 0 0 1e400", false, 0);
+    checkText("GEOM", false, 0);
+    {
+        istringstream in("3 0 0 1 0 x");
+        GeometryIO::ByteSource source(in, 2);
+        GeometryIO::TextReader<fType> reader(source);
+        Polygon polygon;
+        assert(!reader.readPolygon(polygon) && reader.malformed());
+    }
+
+    // Двоичный файл, обрезанный на каждом байте: корректен только на границе записи
+    const vector<Polygon> few(polygons.begin(), polygons.begin() + 6);
+    const string binary = writeToString(few, GeometryIO::Format::Binary);
+    vector<size_t> boundaries;
+    for (size_t count = 0; count <= few.size(); ++count) {
+        boundaries.push_back(writeToString(vector<Polygon>(few.begin(), few.begin() + static_cast<ptrdiff_t>(count)), GeometryIO::Format::Binary).size());
+    }
+    for (size_t length = 0; length < binary.size(); ++length) {
+        const auto boundary = find(boundaries.begin(), boundaries.end(), length);
+        const bool isBoundary = length == 0 || boundary != boundaries.end();
+        const size_t complete = static_cast<size_t>(upper_bound(boundaries.begin(), boundaries.end(), length) - boundaries.begin());
+        for (size_t chunkSize : {size_t(1), size_t(5), size_t(1 << 16)}) {
+            vector<Polygon> read;
+            assert(readChunked(binary.substr(0, length), chunkSize, read) == isBoundary);
+            assert(read.size() == (complete == 0 ? 0 : complete - 1));
+        }
+    }
+    // Двоичный файл с точками не читается как файл многоугольников
+    ostringstream points;
+    GeometryIO::writePoints<fType>(points, vector<Point>{Point(1, 2)}, GeometryIO::Format::Binary);
+    vector<Polygon> read;
+    assert(!readChunked(points.str(), 4, read) && read.empty());
+}
+
+int main() {
+    // Тесты площади
+    testPolygonArea();
+    testPolygonAreaFarFromOrigin();
+
+    // Тесты предикатов и принадлежности точки
+    testOrientation();
+    testPreparedPolygonContainsHull();
+
+    // Тесты оболочек и булевых операций
+    testConvexHull();
+    testMinkowskiSum();
+    testConvexIntersection();
+    testPolygonClipper();
+
+    // Тесты R-дерева
+    testRTree();
+
+    // Тесты сигнатур многоугольников
+    testPolygonSignature();
+
+    // Тесты ленивых преобразований
+    testLazyTransform();
+
+    // Тесты коллекции фигур
+    testShapeCollection();
+
+    // Тесты чтения и записи
+    testGeometryIO();
+
+    cout << "All tests passed!" << endl;
+    return 0;
+}
@@ -0,0 +1,216 @@
+#include "matrix.h"
+#include <chrono>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+//Sweeps det, rank, inverted and operator* over sizes and fields and prints one table row per case:
+//time per call, ns per element operation (the n^3 term), GFLOP-equivalents and the speedup over a naive reference.
+//batch-inv rows give the time per matrix of MatrixBatch::inverted() against PLUDecomposition::inverse() one by one.
+//Usage: ./benchmark [seconds per case], e.g. ./benchmark 0.5 > bench_output.txt
+
+namespace {
+
+double minSecondsPerCase = 0.2;
+
+template<typename Function>
+double measureSeconds(Function function) { //repeats the call until minSecondsPerCase has passed, returns seconds per call
+  using Clock = std::chrono::steady_clock;
+  size_t calls = 0;
+  const auto start = Clock::now();
+  double elapsed = 0;
+  do {
+    function();
+    ++calls;
+    elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+  } while (elapsed < minSecondsPerCase);
+  return elapsed / static_cast<double>(calls);
+}
+
+template<typename Field>
+std::string fieldName() {
+  if constexpr (std::is_same_v<Field, double>) {
+    return "double";
+  } else if constexpr (std::is_same_v<Field, Rational>) {
+    return "Rational";
+  } else {
+    return "Residue<p>";
+  }
+}
+
+template<size_t Size, typename Field>
+std::unique_ptr<SquareMatrix<Size, Field>> randomMatrix(std::mt19937& generator) { //small integer entries, non-singular with high probability
+  auto matrix = std::make_unique<SquareMatrix<Size, Field>>();
+  for (size_t i = 0; i < Size; ++i) {
+    for (size_t j = 0; j < Size; ++j) {
+      (*matrix)[i, j] = Field(static_cast<int>(generator() % 19) - 9);
+    }
+  }
+  return matrix;
+}
+
+//reference kernels: textbook loops without blocking, row kernels or Strassen
+template<size_t Size, typename Field>
+void naiveMultiply(const SquareMatrix<Size, Field>& lhs, const SquareMatrix<Size, Field>& rhs, SquareMatrix<Size, Field>& result) {
+  for (size_t i = 0; i < Size; ++i) {
+    for (size_t j = 0; j < Size; ++j) {
+      Field sum = Field(0);
+      for (size_t k = 0; k < Size; ++k) {
+        sum += lhs[i, k] * rhs[k, j];
+      }
+      result[i, j] = sum;
+    }
+  }
+}
+
+template<size_t Size, typename Field>
+Field naiveDet(SquareMatrix<Size, Field> matrix) {
+  Field det = Field(1);
+  for (size_t column = 0; column < Size; ++column) {
+    size_t pivot = column;
+    while (pivot < Size && matrix[pivot, column] == Field(0)) {
+      ++pivot;
+    }
+    if (pivot == Size) {
+      return Field(0);
+    }
+    if (pivot != column) {
+      for (size_t j = 0; j < Size; ++j) {
+        std::swap(matrix[pivot, j], matrix[column, j]);
+      }
+      det *= Field(-1);
+    }
+    det *= matrix[column, column];
+    for (size_t i = column + 1; i < Size; ++i) {
+      const Field factor = matrix[i, column] / matrix[column, column];
+      for (size_t j = column; j < Size; ++j) {
+        matrix[i, j] -= factor * matrix[column, j];
+      }
+    }
+  }
+  return det;
+}
+
+void printHeader() {
+  std::cout << std::left << std::setw(12) << "field" << std::setw(6) << "n" << std::setw(11) << "operation"
+            << std::right << std::setw(14) << "time, us" << std::setw(14) << "ns/elem-op" << std::setw(12) << "GFLOP-eq"
+            << std::setw(14) << "naive, us" << std::setw(10) << "speedup" << '\n';
+}
+
+//flops is the conventional operation count (2n^3 for a product, 2n^3/3 for elimination); naiveSeconds <= 0 means no reference
+void printRow(const std::string& field, size_t size, const std::string& operation, double seconds, double flops, double naiveSeconds) {
+  const double elementOperations = static_cast<double>(size) * static_cast<double>(size) * static_cast<double>(size);
+  std::cout << std::left << std::setw(12) << field << std::setw(6) << size << std::setw(11) << operation << std::right << std::fixed
+            << std::setprecision(2) << std::setw(14) << seconds * 1e6 << std::setw(14) << seconds * 1e9 / elementOperations
+            << std::setprecision(3) << std::setw(12) << flops / seconds * 1e-9;
+  if (naiveSeconds > 0) {
+    std::cout << std::setprecision(2) << std::setw(14) << naiveSeconds * 1e6 << std::setw(9) << naiveSeconds / seconds << 'x';
+  }
+  std::cout << '\n';
+}
+
+template<size_t Size, typename Field>
+void benchmarkCase(std::mt19937& generator) {
+  const auto lhs = randomMatrix<Size, Field>(generator);
+  const auto rhs = randomMatrix<Size, Field>(generator);
+  auto result = std::make_unique<SquareMatrix<Size, Field>>();
+  const std::string field = fieldName<Field>();
+  const double cube = static_cast<double>(Size) * static_cast<double>(Size) * static_cast<double>(Size);
+
+  volatile size_t sink = 0; //keeps results observable so the calls are not optimized away
+  const double multiplySeconds = measureSeconds([&] { multiply(*lhs, *rhs, *result); sink = sink + ((*result)[0, 0] == Field(0)); });
+  const double naiveMultiplySeconds = measureSeconds([&] { naiveMultiply(*lhs, *rhs, *result); sink = sink + ((*result)[0, 0] == Field(0)); });
+  printRow(field, Size, "multiply", multiplySeconds, 2 * cube, naiveMultiplySeconds);
+
+  const double detSeconds = measureSeconds([&] { sink = sink + (lhs->det() == Field(0)); });
+  const double naiveDetSeconds = measureSeconds([&] { sink = sink + (naiveDet(*lhs) == Field(0)); });
+  printRow(field, Size, "det", detSeconds, 2 * cube / 3, naiveDetSeconds);
+
+  const double rankSeconds = measureSeconds([&] { sink = sink + lhs->rank(); });
+  printRow(field, Size, "rank", rankSeconds, 2 * cube / 3, 0);
+
+  const double invertedSeconds = measureSeconds([&] { *result = lhs->inverted(); sink = sink + ((*result)[0, 0] == Field(0)); });
+  printRow(field, Size, "inverted", invertedSeconds, 2 * cube, 0);
+}
+
+template<size_t Size, typename Field>
+void benchmarkMultiplyCase(std::mt19937& generator) { //product only, for sizes where det and inverted take too long
+  auto lhs = randomMatrix<Size, Field>(generator);
+  auto rhs = randomMatrix<Size, Field>(generator);
+  if constexpr (std::is_same_v<Field, Rational>) { //fractional entries: every sum then reduces by a non-trivial gcd
+    for (auto* matrix : {lhs.get(), rhs.get()}) {
+      for (size_t i = 0; i < Size; ++i) {
+        for (size_t j = 0; j < Size; ++j) {
+          (*matrix)[i, j] /= Rational(static_cast<int>(generator() % 9) + 1);
+        }
+      }
+    }
+  }
+  auto result = std::make_unique<SquareMatrix<Size, Field>>();
+  const double cube = static_cast<double>(Size) * static_cast<double>(Size) * static_cast<double>(Size);
+
+  volatile size_t sink = 0;
+  const double multiplySeconds = measureSeconds([&] { multiply(*lhs, *rhs, *result); sink = sink + ((*result)[0, 0] == Field(0)); });
+  const double naiveMultiplySeconds = measureSeconds([&] { naiveMultiply(*lhs, *rhs, *result); sink = sink + ((*result)[0, 0] == Field(0)); });
+  printRow(fieldName<Field>(), Size, "multiply", multiplySeconds, 2 * cube, naiveMultiplySeconds);
+}
+
+template<size_t Size, typename Field>
+void benchmarkBatchCase(std::mt19937& generator) {
+  constexpr size_t kCount = 4096;
+  std::vector<SquareMatrix<Size, Field>> matrices;
+  matrices.reserve(kCount);
+  while (matrices.size() < kCount) { //singular matrices have no inverse to compare
+    const auto matrix = randomMatrix<Size, Field>(generator);
+    if (!PLUDecomposition<Size, Field>(*matrix).isSingular()) {
+      matrices.push_back(*matrix);
+    }
+  }
+  const MatrixBatch<Size, Field> batch(matrices);
+  const double cube = static_cast<double>(Size) * static_cast<double>(Size) * static_cast<double>(Size);
+
+  volatile size_t sink = 0;
+  const double batchSeconds = measureSeconds([&] { sink = sink + (batch.inverted()[0, 0, 0] == Field(0)); }) / kCount;
+  const double singleSeconds = measureSeconds([&] {
+    for (const auto& matrix : matrices) {
+      sink = sink + (PLUDecomposition<Size, Field>(matrix).inverse()[0, 0] == Field(0));
+    }
+  }) / kCount;
+  printRow(fieldName<Field>(), Size, "batch-inv", batchSeconds, 2 * cube, singleSeconds);
+}
+
+template<typename Field, size_t... Sizes>
+void benchmarkField(std::mt19937& generator) {
+  (benchmarkCase<Sizes, Field>(generator), ...);
+}
+
+template<typename Field, size_t... Sizes>
+void benchmarkMultiplyField(std::mt19937& generator) {
+  (benchmarkMultiplyCase<Sizes, Field>(generator), ...);
+}
+
+template<typename Field, size_t... Sizes>
+void benchmarkBatchField(std::mt19937& generator) {
+  (benchmarkBatchCase<Sizes, Field>(generator), ...);
+}
+
+}
+
+int main(int argc, char** argv) {
+  if (argc > 1) {
+    minSecondsPerCase = std::atof(argv[1]);
+  }
+  std::mt19937 generator(2024);
+  printHeader();
+  benchmarkField<double, 4, 8, 32, 64, 128, 256>(generator);
+  benchmarkField<Residue<998244353>, 4, 8, 32, 64, 128, 256>(generator);
+  benchmarkField<Rational, 4, 8, 16>(generator); //entries grow during elimination, size 32 already takes minutes
+  benchmarkMultiplyField<Rational, 48, 64>(generator); //products stay cheap enough: these sizes cover the Strassen choice for Rational
+  benchmarkBatchField<double, 3, 4, 8>(generator);
+  benchmarkBatchField<Residue<998244353>, 3, 4, 8>(generator);
+  return 0;
+}
@@ -0,0 +1,323 @@
+#pragma once
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "matrix.h"
+
+//Binary matrix files: a versioned header followed by the elements row by row.
+//All words are little-endian, so files are portable between hosts.
+namespace MatrixIO {
+
+constexpr char kMagic[4] = {'M', 'T', 'R', 'X'};
+constexpr uint16_t kVersion = 1;
+
+enum class FieldKind : uint8_t {
+  Double = 1,
+  Residue = 2,
+  BigInteger = 3,
+  Rational = 4,
+};
+
+struct Header { //magic, version, field kind, rows, columns, modulus (zero unless Residue) and limb base (zero unless BigInteger or Rational)
+  static constexpr size_t kSize = sizeof(kMagic) + sizeof(uint16_t) + sizeof(uint8_t) + sizeof(uint8_t) + 3 * sizeof(uint64_t) + sizeof(uint32_t);
+
+  FieldKind kind = FieldKind::Double;
+  uint64_t rows = 0;
+  uint64_t columns = 0;
+  uint64_t modulus = 0;
+  uint32_t limbBase = 0;
+
+  void write(std::ostream& out) const {
+    out.write(kMagic, sizeof(kMagic));
+    BinaryFormat::write<uint16_t>(out, kVersion);
+    BinaryFormat::write<uint8_t>(out, static_cast<uint8_t>(kind));
+    BinaryFormat::write<uint8_t>(out, 0); //reserved
+    BinaryFormat::write<uint64_t>(out, rows);
+    BinaryFormat::write<uint64_t>(out, columns);
+    BinaryFormat::write<uint64_t>(out, modulus);
+    BinaryFormat::write<uint32_t>(out, limbBase);
+  }
+
+  bool read(const unsigned char*& cursor, const unsigned char* end) {
+    if (static_cast<size_t>(end - cursor) < kSize || std::memcmp(cursor, kMagic, sizeof(kMagic)) != 0) {
+      return false;
+    }
+    cursor += sizeof(kMagic);
+    uint16_t version = 0;
+    uint8_t kindByte = 0;
+    uint8_t reserved = 0;
+    BinaryFormat::read(cursor, end, version);
+    BinaryFormat::read(cursor, end, kindByte);
+    BinaryFormat::read(cursor, end, reserved);
+    BinaryFormat::read(cursor, end, rows);
+    BinaryFormat::read(cursor, end, columns);
+    BinaryFormat::read(cursor, end, modulus);
+    BinaryFormat::read(cursor, end, limbBase);
+    kind = static_cast<FieldKind>(kindByte);
+    return version == kVersion;
+  }
+
+  friend bool operator==(const Header& lhs, const Header& rhs) = default;
+};
+
+template<typename Field>
+struct FieldCodec;
+
+template<>
+struct FieldCodec<double> {
+  static constexpr FieldKind kKind = FieldKind::Double;
+  static constexpr uint64_t kModulus = 0;
+  static constexpr uint32_t kLimbBase = 0;
+  static constexpr size_t kFixedWidth = sizeof(uint64_t); //IEEE 754 bits
+
+  static void write(std::ostream& out, double value) {
+    uint64_t bits = 0;
+    std::memcpy(&bits, &value, sizeof(bits));
+    BinaryFormat::write(out, bits);
+  }
+
+  static bool read(const unsigned char*& cursor, const unsigned char* end, double& value) {
+    uint64_t bits = 0;
+    if (!BinaryFormat::read(cursor, end, bits)) {
+      return false;
+    }
+    std::memcpy(&value, &bits, sizeof(bits));
+    return true;
+  }
+};
+
+template<size_t Modulus>
+struct FieldCodec<Residue<Modulus>> {
+  static constexpr FieldKind kKind = FieldKind::Residue;
+  static constexpr uint64_t kModulus = Modulus;
+  static constexpr uint32_t kLimbBase = 0;
+  static constexpr size_t kFixedWidth = sizeof(uint64_t); //canonical value, independent of the inner reduction form
+
+  static void write(std::ostream& out, const Residue<Modulus>& value) {
+    BinaryFormat::write<uint64_t>(out, value.value());
+  }
+
+  static bool read(const unsigned char*& cursor, const unsigned char* end, Residue<Modulus>& value) {
+    uint64_t word = 0;
+    if (!BinaryFormat::read(cursor, end, word) || word >= Modulus) {
+      return false;
+    }
+    value = Residue<Modulus>::fromValue(word);
+    return true;
+  }
+};
+
+template<typename Number>
+struct BigNumberCodec { //variable-width records written by the number itself
+  static constexpr uint64_t kModulus = 0;
+  static constexpr uint32_t kLimbBase = 100000; //BigInteger limbs are decimal groups of five digits
+  static constexpr size_t kFixedWidth = 0;
+
+  static void write(std::ostream& out, const Number& value) {
+    value.writeBinary(out);
+  }
+
+  static bool read(const unsigned char*& cursor, const unsigned char* end, Number& value) {
+    return Number::readBinary(cursor, end, value);
+  }
+
+  static bool read(std::istream& in, Number& value) { //bounded chunked read of exactly one record
+    return Number::readBinary(in, value);
+  }
+};
+
+template<>
+struct FieldCodec<BigInteger> : BigNumberCodec<BigInteger> {
+  static constexpr FieldKind kKind = FieldKind::BigInteger;
+};
+
+template<>
+struct FieldCodec<Rational> : BigNumberCodec<Rational> {
+  static constexpr FieldKind kKind = FieldKind::Rational;
+};
+
+template<size_t Rows, size_t Сolumns, typename Field>
+Header headerOf() {
+  return Header{FieldCodec<Field>::kKind, Rows, Сolumns, FieldCodec<Field>::kModulus, FieldCodec<Field>::kLimbBase};
+}
+
+template<size_t Rows, size_t Сolumns, typename Field>
+void writeMatrix(std::ostream& out, const Matrix<Rows, Сolumns, Field>& matrix) {
+  headerOf<Rows, Сolumns, Field>().write(out);
+  for (size_t i = 0; i < Rows; ++i) {
+    for (const Field& value : matrix.row(i)) {
+      FieldCodec<Field>::write(out, value);
+    }
+  }
+}
+
+template<size_t Rows, size_t Сolumns, typename Field>
+bool readElements(const unsigned char*& cursor, const unsigned char* end, Matrix<Rows, Сolumns, Field>& matrix) {
+  for (size_t i = 0; i < Rows; ++i) {
+    for (Field& value : matrix.row(i)) {
+      if (!FieldCodec<Field>::read(cursor, end, value)) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+
+//decodes a whole file image; false if the header does not describe this matrix type or the data is truncated
+template<size_t Rows, size_t Сolumns, typename Field>
+bool readMatrix(const unsigned char* begin, const unsigned char* end, Matrix<Rows, Сolumns, Field>& matrix) {
+  Header header;
+  if (!header.read(begin, end) || !(header == headerOf<Rows, Сolumns, Field>())) {
+    return false;
+  }
+  return readElements(begin, end, matrix);
+}
+
+//consumes the header and this matrix's elements only, so matrices written one after another read back one by one;
+//fixed-width payloads are read in one block, variable-width ones record by record through the codec
+template<size_t Rows, size_t Сolumns, typename Field>
+bool readMatrix(std::istream& in, Matrix<Rows, Сolumns, Field>& matrix) {
+  unsigned char headerBytes[Header::kSize];
+  if (!in.read(reinterpret_cast<char*>(headerBytes), Header::kSize)) {
+    return false;
+  }
+  const unsigned char* cursor = headerBytes;
+  Header header;
+  if (!header.read(cursor, headerBytes + Header::kSize) || !(header == headerOf<Rows, Сolumns, Field>())) {
+    return false;
+  }
+  if constexpr (FieldCodec<Field>::kFixedWidth != 0) {
+    std::vector<unsigned char> payload(Rows * Сolumns * FieldCodec<Field>::kFixedWidth);
+    if (!in.read(reinterpret_cast<char*>(payload.data()), static_cast<std::streamsize>(payload.size()))) {
+      return false;
+    }
+    cursor = payload.data();
+    return readElements(cursor, payload.data() + payload.size(), matrix);
+  } else {
+    for (size_t i = 0; i < Rows; ++i) {
+      for (Field& value : matrix.row(i)) {
+        if (!FieldCodec<Field>::read(in, value)) {
+          return false;
+        }
+      }
+    }
+    return true;
+  }
+}
+
+class MappedFile { //read-only memory mapping of a whole file
+public:
+  explicit MappedFile(const std::string& path) {
+    const int descriptor = ::open(path.c_str(), O_RDONLY);
+    if (descriptor < 0) {
+      return;
+    }
+    struct stat status{};
+    if (::fstat(descriptor, &status) == 0 && status.st_size > 0) {
+      void* mapping = ::mmap(nullptr, static_cast<size_t>(status.st_size), PROT_READ, MAP_PRIVATE, descriptor, 0);
+      if (mapping != MAP_FAILED) {
+        data_ = static_cast<const unsigned char*>(mapping);
+        size_ = static_cast<size_t>(status.st_size);
+        ::madvise(mapping, size_, MADV_SEQUENTIAL);
+      }
+    }
+    ::close(descriptor); //the mapping outlives the descriptor
+  }
+
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+  MappedFile(MappedFile&& other) noexcept
+    : data_(std::exchange(other.data_, nullptr))
+    , size_(std::exchange(other.size_, 0))
+  {}
+
+  MappedFile& operator=(MappedFile&& other) noexcept {
+    std::swap(data_, other.data_);
+    std::swap(size_, other.size_);
+    return *this;
+  }
+
+  ~MappedFile() {
+    if (data_ != nullptr) {
+      ::munmap(const_cast<unsigned char*>(data_), size_);
+    }
+  }
+
+  bool isOpen() const {
+    return data_ != nullptr;
+  }
+
+  const unsigned char* data() const {
+    return data_;
+  }
+
+  size_t size() const {
+    return size_;
+  }
+
+private:
+  const unsigned char* data_ = nullptr;
+  size_t size_ = 0;
+};
+
+template<size_t Rows, size_t Сolumns, typename Field>
+bool saveMatrix(const std::string& path, const Matrix<Rows, Сolumns, Field>& matrix) {
+  std::ofstream out(path, std::ios::binary);
+  writeMatrix(out, matrix);
+  return static_cast<bool>(out.flush());
+}
+
+template<size_t Rows, size_t Сolumns, typename Field>
+bool loadMatrix(const std::string& path, Matrix<Rows, Сolumns, Field>& matrix) { //decodes straight from the mapped file, no stream buffering
+  const MappedFile file(path);
+  return file.isOpen() && readMatrix(file.data(), file.data() + file.size(), matrix);
+}
+
+//read-only matrix backed by a mapped file: elements are decoded on access, nothing is loaded up front.
+//Only fixed-width fields can be addressed this way; it is a MatrixOperand, so Matrix m = mapped; copies it
+template<size_t Rows, size_t Сolumns, typename Field>
+class MappedMatrix {
+  static_assert(FieldCodec<Field>::kFixedWidth != 0, "only fixed-width fields can be accessed in place");
+public:
+  static constexpr size_t kRows = Rows;
+  static constexpr size_t kColumns = Сolumns;
+  using FieldType = Field;
+
+  explicit MappedMatrix(const std::string& path)
+    : file_(path) {
+    const unsigned char* cursor = file_.data();
+    const unsigned char* end = cursor + file_.size();
+    Header header;
+    isValid_ = file_.isOpen() && header.read(cursor, end) && header == headerOf<Rows, Сolumns, Field>()
+               && static_cast<size_t>(end - cursor) >= Rows * Сolumns * FieldCodec<Field>::kFixedWidth;
+    elements_ = cursor;
+  }
+
+  bool isValid() const {
+    return isValid_;
+  }
+
+  Field operator[](size_t x, size_t y) const {
+    assert(isValid_ && x < Rows && y < Сolumns && "Element of an invalid mapped matrix or out of range");
+    const unsigned char* cursor = elements_ + (x * Сolumns + y) * FieldCodec<Field>::kFixedWidth;
+    Field value;
+    const bool isDecoded = FieldCodec<Field>::read(cursor, cursor + FieldCodec<Field>::kFixedWidth, value);
+    assert(isDecoded && "Corrupt element in a mapped matrix"); //e.g. a Residue word not below the modulus
+    static_cast<void>(isDecoded);
+    return value;
+  }
+
+private:
+  MappedFile file_;
+  const unsigned char* elements_ = nullptr;
+  bool isValid_ = false;
+};
+
+}
@@ -0,0 +1,323 @@
+#pragma once
+#include "matrix.h"
+#include "../biginteger_rational/fft.h"
+
+template<typename Field>
+struct IsResidueField : std::false_type {};
+
+template<size_t Modulus>
+struct IsResidueField<Residue<Modulus>> : std::true_type {
+  static constexpr uint64_t kModulus = Modulus;
+};
+
+template<typename Field>
+class Polynomial { //dense, coefficients from x^0; the zero polynomial stores no coefficients
+public:
+  Polynomial() = default;
+
+  explicit Polynomial(const Field& constant) : coefficients_{constant} {
+    trim();
+  }
+
+  explicit Polynomial(std::vector<Field> coefficients) : coefficients_(std::move(coefficients)) {
+    trim();
+  }
+
+  Polynomial(std::initializer_list<Field> coefficients) : coefficients_(coefficients) {
+    trim();
+  }
+
+  ssize_t degree() const { //-1 for the zero polynomial
+    return static_cast<ssize_t>(coefficients_.size()) - 1;
+  }
+
+  bool isZero() const {
+    return coefficients_.empty();
+  }
+
+  size_t size() const {
+    return coefficients_.size();
+  }
+
+  const std::vector<Field>& coefficients() const {
+    return coefficients_;
+  }
+
+  Field operator[](size_t index) const {
+    return index < coefficients_.size() ? coefficients_[index] : kZero;
+  }
+
+  Field operator()(const Field& point) const { //Horner
+    Field result = kZero;
+    for (size_t i = coefficients_.size(); i > 0; --i) {
+      result = result * point + coefficients_[i - 1];
+    }
+    return result;
+  }
+
+  //values at every point: remainders modulo a subproduct tree of (x - point), O(n log^2 n) with fast multiplication;
+  //floating point fields use Horner at every point
+  std::vector<Field> evaluate(const std::vector<Field>& points) const {
+    std::vector<Field> values(points.size());
+    if (std::is_floating_point_v<Field> || points.size() <= kNaiveThreshold) {
+      for (size_t i = 0; i < points.size(); ++i) {
+        values[i] = (*this)(points[i]);
+      }
+      return values;
+    }
+    std::vector<Polynomial> tree(4 * points.size());
+    buildSubproductTree(tree, points, 1, 0, points.size());
+    evaluateOnTree(*this % tree[1], tree, points, 1, 0, points.size(), values);
+    return values;
+  }
+
+  //first terms coefficients of the power series 1 / p, Newton iteration g = g * (2 - p * g) doubles the precision each step
+  Polynomial inverseSeries(size_t terms) const {
+    assert(!isZero() && coefficients_[0] != kZero && "Series is invertible only with a non-zero constant term");
+    Polynomial inverse(kOne / coefficients_[0]);
+    for (size_t precision = 1; precision < terms;) {
+      precision = std::min(precision * 2, terms);
+      Polynomial correction = -(truncated(precision) * inverse).truncated(precision);
+      if (correction.isZero()) {
+        correction.coefficients_.push_back(kZero);
+      }
+      correction.coefficients_[0] += Field(2);
+      correction.trim();
+      inverse = (inverse * correction).truncated(precision);
+    }
+    return inverse.truncated(terms);
+  }
+
+  //quotient and remainder; long division for short quotients, otherwise the reversed quotient is rev(dividend) / rev(divisor)
+  static std::pair<Polynomial, Polynomial> divide(const Polynomial& dividend, const Polynomial& divisor) {
+    assert(!divisor.isZero() && "Division by the zero polynomial");
+    if (dividend.degree() < divisor.degree()) {
+      return {Polynomial(), dividend};
+    }
+    const size_t quotientSize = static_cast<size_t>(dividend.degree() - divisor.degree()) + 1;
+    //the reversed divisor's series grows geometrically when it has roots inside the unit circle: floating point uses long division
+    if (std::is_floating_point_v<Field> || quotientSize <= kNaiveThreshold || divisor.size() <= kNaiveThreshold) {
+      return longDivision(dividend, divisor);
+    }
+    const Polynomial reversedQuotient =
+      (dividend.reversed().truncated(quotientSize) * divisor.reversed().inverseSeries(quotientSize)).truncated(quotientSize);
+    Polynomial quotient = reversedQuotient.reversed(quotientSize);
+    Polynomial remainder = (dividend - divisor * quotient).truncated(divisor.size() - 1);
+    return {std::move(quotient), std::move(remainder)};
+  }
+
+  Polynomial operator-() const {
+    Polynomial result(*this);
+    for (Field& coefficient : result.coefficients_) {
+      coefficient = kZero - coefficient;
+    }
+    return result;
+  }
+
+  Polynomial& operator+=(const Polynomial& rhs) {
+    if (coefficients_.size() < rhs.coefficients_.size()) {
+      coefficients_.resize(rhs.coefficients_.size(), kZero);
+    }
+    for (size_t i = 0; i < rhs.coefficients_.size(); ++i) {
+      coefficients_[i] += rhs.coefficients_[i];
+    }
+    trim();
+    return *this;
+  }
+
+  Polynomial& operator-=(const Polynomial& rhs) {
+    if (coefficients_.size() < rhs.coefficients_.size()) {
+      coefficients_.resize(rhs.coefficients_.size(), kZero);
+    }
+    for (size_t i = 0; i < rhs.coefficients_.size(); ++i) {
+      coefficients_[i] -= rhs.coefficients_[i];
+    }
+    trim();
+    return *this;
+  }
+
+  Polynomial& operator*=(const Polynomial& rhs) {
+    coefficients_ = convolve(coefficients_, rhs.coefficients_);
+    trim();
+    return *this;
+  }
+
+  Polynomial& operator*=(const Field& scalar) {
+    for (Field& coefficient : coefficients_) {
+      coefficient *= scalar;
+    }
+    trim();
+    return *this;
+  }
+
+  Polynomial& operator/=(const Polynomial& rhs) {
+    return *this = divide(*this, rhs).first;
+  }
+
+  Polynomial& operator%=(const Polynomial& rhs) {
+    return *this = divide(*this, rhs).second;
+  }
+
+  friend Polynomial operator+(Polynomial lhs, const Polynomial& rhs) {
+    return lhs += rhs;
+  }
+
+  friend Polynomial operator-(Polynomial lhs, const Polynomial& rhs) {
+    return lhs -= rhs;
+  }
+
+  friend Polynomial operator*(Polynomial lhs, const Polynomial& rhs) {
+    return lhs *= rhs;
+  }
+
+  friend Polynomial operator*(Polynomial lhs, const Field& scalar) {
+    return lhs *= scalar;
+  }
+
+  friend Polynomial operator*(const Field& scalar, Polynomial rhs) {
+    return rhs *= scalar;
+  }
+
+  friend Polynomial operator/(const Polynomial& lhs, const Polynomial& rhs) {
+    return divide(lhs, rhs).first;
+  }
+
+  friend Polynomial operator%(const Polynomial& lhs, const Polynomial& rhs) {
+    return divide(lhs, rhs).second;
+  }
+
+  friend bool operator==(const Polynomial& lhs, const Polynomial& rhs) {
+    return lhs.coefficients_ == rhs.coefficients_;
+  }
+
+private:
+  inline static const Field kZero = Field(0);
+  inline static const Field kOne = Field(1);
+  static const size_t kNaiveThreshold = 32; //below this many terms the schoolbook kernels beat the transforms
+
+  std::vector<Field> coefficients_;
+
+  void trim() {
+    while (!coefficients_.empty() && coefficients_.back() == kZero) {
+      coefficients_.pop_back();
+    }
+  }
+
+  Polynomial truncated(size_t terms) const { //modulo x^terms
+    Polynomial result;
+    result.coefficients_.assign(coefficients_.begin(), coefficients_.begin() + static_cast<ssize_t>(std::min(terms, coefficients_.size())));
+    result.trim();
+    return result;
+  }
+
+  Polynomial reversed(size_t length) const { //x^(length - 1) * p(1 / x)
+    std::vector<Field> result(length, kZero);
+    for (size_t i = 0; i < std::min(length, coefficients_.size()); ++i) {
+      result[length - 1 - i] = coefficients_[i];
+    }
+    return Polynomial(std::move(result));
+  }
+
+  Polynomial reversed() const {
+    return reversed(coefficients_.size());
+  }
+
+  //schoolbook rows through the same kernels as matrix elimination, fast transforms for long operands of suitable fields
+  static std::vector<Field> convolve(const std::vector<Field>& lhs, const std::vector<Field>& rhs) {
+    if (lhs.empty() || rhs.empty()) {
+      return {};
+    }
+    if constexpr (std::is_same_v<Field, double>) {
+      if (std::min(lhs.size(), rhs.size()) > kNaiveThreshold) {
+        return Transform::ComplexTransform::convolve(lhs, rhs);
+      }
+    } else if constexpr (IsResidueField<Field>::value) {
+      if (std::min(lhs.size(), rhs.size()) > kNaiveThreshold) {
+        if (auto product = convolveResidues(lhs, rhs); !product.empty()) {
+          return product;
+        }
+      }
+    }
+    const std::vector<Field>& shorter = lhs.size() < rhs.size() ? lhs : rhs;
+    const std::vector<Field>& longer = lhs.size() < rhs.size() ? rhs : lhs;
+    std::vector<Field> result(lhs.size() + rhs.size() - 1, kZero);
+    for (size_t i = 0; i < shorter.size(); ++i) {
+      if (shorter[i] != kZero) {
+        RowOperations<Field>::addMultiple(result.data() + i, longer.data(), shorter[i], longer.size());
+      }
+    }
+    return result;
+  }
+
+  //one transform modulo the prime itself when it has enough roots of unity, three primes and CRT for other moduli
+  //below 2^32; an empty result sends the caller to the schoolbook kernel
+  static std::vector<Field> convolveResidues(const std::vector<Field>& lhs, const std::vector<Field>& rhs) {
+    constexpr uint64_t kModulus = IsResidueField<Field>::kModulus;
+    if constexpr (kModulus < (uint64_t(1) << 32)) {
+      std::vector<uint64_t> left(lhs.size());
+      std::vector<uint64_t> right(rhs.size());
+      for (size_t i = 0; i < lhs.size(); ++i) {
+        left[i] = lhs[i].value();
+      }
+      for (size_t i = 0; i < rhs.size(); ++i) {
+        right[i] = rhs[i].value();
+      }
+      std::vector<uint64_t> product;
+      if constexpr (kModulus > 2 && IsPrime<kModulus>::value) {
+        if (Transform::transformLength(lhs.size() + rhs.size() - 1) <= Transform::NumberTheoreticTransform<kModulus>::kMaxLength) {
+          product = Transform::NumberTheoreticTransform<kModulus>::convolve(left, right);
+        }
+      }
+      if (product.empty()) {
+        product = Transform::convolveModulo(left, right, kModulus);
+      }
+      std::vector<Field> result(product.size());
+      for (size_t i = 0; i < product.size(); ++i) {
+        result[i] = Field::fromValue(product[i]);
+      }
+      return result;
+    } else {
+      return {};
+    }
+  }
+
+  static std::pair<Polynomial, Polynomial> longDivision(const Polynomial& dividend, const Polynomial& divisor) {
+    std::vector<Field> remainder = dividend.coefficients_;
+    const size_t divisorSize = divisor.coefficients_.size();
+    std::vector<Field> quotient(remainder.size() - divisorSize + 1, kZero);
+    const Field leadingInverse = kOne / divisor.coefficients_.back();
+    for (size_t i = quotient.size(); i > 0; --i) {
+      const Field factor = remainder[i - 1 + divisorSize - 1] * leadingInverse;
+      quotient[i - 1] = factor;
+      if (factor != kZero) {
+        RowOperations<Field>::addMultiple(remainder.data() + i - 1, divisor.coefficients_.data(), kZero - factor, divisorSize);
+      }
+    }
+    remainder.resize(divisorSize - 1);
+    return {Polynomial(std::move(quotient)), Polynomial(std::move(remainder))};
+  }
+
+  static void buildSubproductTree(std::vector<Polynomial>& tree, const std::vector<Field>& points, size_t node, size_t begin, size_t end) {
+    if (end - begin == 1) {
+      tree[node] = Polynomial{kZero - points[begin], kOne};
+      return;
+    }
+    const size_t middle = begin + (end - begin) / 2;
+    buildSubproductTree(tree, points, 2 * node, begin, middle);
+    buildSubproductTree(tree, points, 2 * node + 1, middle, end);
+    tree[node] = tree[2 * node] * tree[2 * node + 1];
+  }
+
+  static void evaluateOnTree(const Polynomial& remainder, const std::vector<Polynomial>& tree, const std::vector<Field>& points,
+                             size_t node, size_t begin, size_t end, std::vector<Field>& values) {
+    if (end - begin <= kNaiveThreshold) { //short remainders are cheaper to evaluate by Horner directly
+      for (size_t i = begin; i < end; ++i) {
+        values[i] = remainder(points[i]);
+      }
+      return;
+    }
+    const size_t middle = begin + (end - begin) / 2;
+    evaluateOnTree(remainder % tree[2 * node], tree, points, 2 * node, begin, middle, values);
+    evaluateOnTree(remainder % tree[2 * node + 1], tree, points, 2 * node + 1, middle, end, values);
+  }
+};
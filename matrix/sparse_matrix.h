@@ -0,0 +1,414 @@
+#pragma once
+#include <algorithm>
+#include <cassert>
+#include <optional>
+#include <random>
+#include <set>
+#include <tuple>
+#include <utility>
+#include <vector>
+#include "matrix.h"
+
+template<typename Field = Rational>
+class SparseMatrix { //compressed sparse rows: the column indices and values of row i lie in [rowOffsets_[i], rowOffsets_[i + 1])
+public:
+  using Entry = std::tuple<size_t, size_t, Field>;
+
+  SparseMatrix(size_t rows, size_t columns)
+    : rows_(rows)
+    , columns_(columns)
+    , rowOffsets_(rows + 1, 0)
+  {}
+
+  SparseMatrix(size_t rows, size_t columns, std::vector<Entry> entries) //duplicates are summed, zeros are dropped
+    : SparseMatrix(rows, columns) {
+    std::sort(entries.begin(), entries.end(), [](const Entry& lhs, const Entry& rhs) {
+      return std::tie(std::get<0>(lhs), std::get<1>(lhs)) < std::tie(std::get<0>(rhs), std::get<1>(rhs));
+    });
+    for (size_t i = 0; i < entries.size();) {
+      auto [row, column, value] = entries[i];
+      assert(row < rows_ && column < columns_ && "Entry is out of the matrix");
+      for (++i; i < entries.size() && std::get<0>(entries[i]) == row && std::get<1>(entries[i]) == column; ++i) {
+        value += std::get<2>(entries[i]);
+      }
+      if (value != kZero) {
+        columnIndices_.push_back(column);
+        values_.push_back(value);
+        ++rowOffsets_[row + 1];
+      }
+    }
+    for (size_t i = 0; i < rows_; ++i) {
+      rowOffsets_[i + 1] += rowOffsets_[i];
+    }
+  }
+
+  template<size_t Rows, size_t Columns>
+  static SparseMatrix fromDense(const Matrix<Rows, Columns, Field>& dense) {
+    SparseMatrix result(Rows, Columns);
+    for (size_t i = 0; i < Rows; ++i) {
+      for (size_t j = 0; j < Columns; ++j) {
+        if (dense[i, j] != kZero) {
+          result.columnIndices_.push_back(j);
+          result.values_.push_back(dense[i, j]);
+        }
+      }
+      result.rowOffsets_[i + 1] = result.values_.size();
+    }
+    return result;
+  }
+
+  size_t rows() const {
+    return rows_;
+  }
+
+  size_t columns() const {
+    return columns_;
+  }
+
+  size_t nonZeros() const {
+    return values_.size();
+  }
+
+  Field at(size_t row, size_t column) const {
+    auto begin = columnIndices_.begin() + static_cast<ssize_t>(rowOffsets_[row]);
+    auto end = columnIndices_.begin() + static_cast<ssize_t>(rowOffsets_[row + 1]);
+    auto it = std::lower_bound(begin, end, column);
+    if (it == end || *it != column) {
+      return kZero;
+    }
+    return values_[static_cast<size_t>(it - columnIndices_.begin())];
+  }
+
+  template<typename Function>
+  void forEachInRow(size_t row, Function function) const { //function(column, value) for every stored entry of the row
+    for (size_t k = rowOffsets_[row]; k < rowOffsets_[row + 1]; ++k) {
+      function(columnIndices_[k], values_[k]);
+    }
+  }
+
+  SparseMatrix transposed() const { //the compressed rows of the transpose are the compressed columns of this matrix
+    SparseMatrix result(columns_, rows_);
+    for (size_t column : columnIndices_) {
+      ++result.rowOffsets_[column + 1];
+    }
+    for (size_t i = 0; i < columns_; ++i) {
+      result.rowOffsets_[i + 1] += result.rowOffsets_[i];
+    }
+    result.columnIndices_.resize(values_.size());
+    result.values_.resize(values_.size());
+    std::vector<size_t> position(result.rowOffsets_.begin(), result.rowOffsets_.end() - 1);
+    for (size_t i = 0; i < rows_; ++i) {
+      for (size_t k = rowOffsets_[i]; k < rowOffsets_[i + 1]; ++k) {
+        size_t target = position[columnIndices_[k]]++;
+        result.columnIndices_[target] = i;
+        result.values_[target] = values_[k];
+      }
+    }
+    return result;
+  }
+
+  std::vector<Field> operator*(const std::vector<Field>& vector) const {
+    assert(vector.size() == columns_ && "Sizes of the matrix and the vector do not match");
+    std::vector<Field> result(rows_, kZero);
+    for (size_t i = 0; i < rows_; ++i) {
+      for (size_t k = rowOffsets_[i]; k < rowOffsets_[i + 1]; ++k) {
+        result[i] += values_[k] * vector[columnIndices_[k]];
+      }
+    }
+    return result;
+  }
+
+  template<size_t ResultRows, size_t Inner, size_t Columns>
+  Matrix<ResultRows, Columns, Field> multiply(const Matrix<Inner, Columns, Field>& dense) const { //every stored entry scales one dense row
+    assert(rows_ == ResultRows && columns_ == Inner && "Sizes of the matrices do not match");
+    Matrix<ResultRows, Columns, Field> result;
+    for (size_t i = 0; i < rows_; ++i) {
+      for (size_t k = rowOffsets_[i]; k < rowOffsets_[i + 1]; ++k) {
+        RowOperations<Field>::subtractMultiple(&result[i, 0], &dense[columnIndices_[k], 0], kZero - values_[k], Columns);
+      }
+    }
+    return result;
+  }
+
+  //structured Gaussian elimination for a square system: each step takes the active column with the fewest entries
+  //and, inside it, the shortest row, which keeps the fill-in low. Returns nullopt for a singular matrix
+  std::optional<std::vector<Field>> solve(std::vector<Field> rhs) const {
+    assert(rows_ == columns_ && rhs.size() == rows_ && "Sparse solve expects a square system");
+    const size_t size = rows_;
+    std::vector<SparseRow> workRows(size);
+    std::vector<std::set<size_t>> columnRows(size); //active rows having a non-zero in the column
+    for (size_t i = 0; i < size; ++i) {
+      for (size_t k = rowOffsets_[i]; k < rowOffsets_[i + 1]; ++k) {
+        workRows[i].emplace_back(columnIndices_[k], values_[k]);
+        columnRows[columnIndices_[k]].insert(i);
+      }
+    }
+
+    ColumnQueue queue(size); //active columns by entry count, so each pivot search costs O(1) amortized instead of O(size)
+    for (size_t j = 0; j < size; ++j) {
+      queue.insert(j, columnRows[j].size());
+    }
+    auto eraseEntry = [&](size_t row, size_t column) {
+      columnRows[column].erase(row);
+      queue.update(column, columnRows[column].size());
+    };
+    auto insertEntry = [&](size_t row, size_t column) {
+      columnRows[column].insert(row);
+      queue.update(column, columnRows[column].size());
+    };
+
+    std::vector<std::pair<size_t, size_t>> pivots; //(row, column) in elimination order
+    pivots.reserve(size);
+    for (size_t step = 0; step < size; ++step) {
+      const size_t pivotColumn = queue.popMinimum();
+      if (columnRows[pivotColumn].empty()) {
+        return std::nullopt;
+      }
+      size_t pivotRow = *columnRows[pivotColumn].begin();
+      for (size_t row : columnRows[pivotColumn]) {
+        if (workRows[row].size() < workRows[pivotRow].size()) {
+          pivotRow = row;
+        }
+      }
+
+      const Field inversePivot = kOne / valueAt(workRows[pivotRow], pivotColumn);
+      for (auto& [column, value] : workRows[pivotRow]) {
+        value *= inversePivot;
+        eraseEntry(pivotRow, column);
+      }
+      rhs[pivotRow] *= inversePivot;
+      pivots.emplace_back(pivotRow, pivotColumn);
+
+      const std::vector<size_t> touchedRows(columnRows[pivotColumn].begin(), columnRows[pivotColumn].end());
+      for (size_t row : touchedRows) {
+        const Field coefficient = valueAt(workRows[row], pivotColumn);
+        for (const auto& [column, value] : workRows[row]) {
+          eraseEntry(row, column);
+        }
+        workRows[row] = subtractRows(workRows[row], workRows[pivotRow], coefficient, pivotColumn);
+        for (const auto& [column, value] : workRows[row]) {
+          insertEntry(row, column);
+        }
+        rhs[row] -= rhs[pivotRow] * coefficient;
+      }
+    }
+
+    std::vector<Field> result(size, kZero);
+    for (size_t k = size; k-- > 0;) { //a pivot row only references columns pivoted after it
+      auto [row, column] = pivots[k];
+      Field value = rhs[row];
+      for (const auto& [otherColumn, coefficient] : workRows[row]) {
+        if (otherColumn != column) {
+          value -= coefficient * result[otherColumn];
+        }
+      }
+      result[column] = value;
+    }
+    return result;
+  }
+
+private:
+  using SparseRow = std::vector<std::pair<size_t, Field>>; //sorted by column
+
+  inline static const Field kZero = Field(0);
+  inline static const Field kOne = Field(1);
+
+  class ColumnQueue { //bucket queue: columns linked into per-count lists, popMinimum scans up from the lowest count seen
+  public:
+    explicit ColumnQueue(size_t columns)
+      : heads_(columns + 1, kNone)
+      , next_(columns, kNone)
+      , previous_(columns, kNone)
+      , counts_(columns, kNone)
+    {}
+
+    void insert(size_t column, size_t count) {
+      counts_[column] = count;
+      previous_[column] = kNone;
+      next_[column] = heads_[count];
+      if (heads_[count] != kNone) {
+        previous_[heads_[count]] = column;
+      }
+      heads_[count] = column;
+      minimum_ = std::min(minimum_, count);
+    }
+
+    void update(size_t column, size_t count) { //popped columns are no longer tracked and are left alone
+      if (counts_[column] != kNone && counts_[column] != count) {
+        erase(column);
+        insert(column, count);
+      }
+    }
+
+    size_t popMinimum() {
+      while (heads_[minimum_] == kNone) {
+        ++minimum_;
+      }
+      const size_t column = heads_[minimum_];
+      erase(column);
+      counts_[column] = kNone;
+      return column;
+    }
+
+  private:
+    static constexpr size_t kNone = static_cast<size_t>(-1);
+
+    std::vector<size_t> heads_;
+    std::vector<size_t> next_;
+    std::vector<size_t> previous_;
+    std::vector<size_t> counts_;
+    size_t minimum_ = 0;
+
+    void erase(size_t column) {
+      if (previous_[column] != kNone) {
+        next_[previous_[column]] = next_[column];
+      } else {
+        heads_[counts_[column]] = next_[column];
+      }
+      if (next_[column] != kNone) {
+        previous_[next_[column]] = previous_[column];
+      }
+    }
+  };
+
+  size_t rows_ = 0;
+  size_t columns_ = 0;
+  std::vector<size_t> rowOffsets_;
+  std::vector<size_t> columnIndices_;
+  std::vector<Field> values_;
+
+  static Field valueAt(const SparseRow& row, size_t column) {
+    auto it = std::lower_bound(row.begin(), row.end(), column, [](const auto& entry, size_t value) {
+      return entry.first < value;
+    });
+    return it != row.end() && it->first == column ? it->second : kZero;
+  }
+
+  //target - coefficient * source, the eliminated column is dropped even if rounding left something in it
+  static SparseRow subtractRows(const SparseRow& target, const SparseRow& source, const Field& coefficient, size_t eliminatedColumn) {
+    SparseRow result;
+    result.reserve(target.size() + source.size());
+    size_t i = 0;
+    size_t j = 0;
+    while (i < target.size() || j < source.size()) {
+      if (j == source.size() || (i < target.size() && target[i].first < source[j].first)) {
+        result.push_back(target[i++]);
+        continue;
+      }
+      Field value = kZero - source[j].second * coefficient;
+      size_t column = source[j++].first;
+      if (i < target.size() && target[i].first == column) {
+        value += target[i++].second;
+      }
+      if (value != kZero && column != eliminatedColumn) {
+        result.emplace_back(column, value);
+      }
+    }
+    return result;
+  }
+};
+
+template<typename Field>
+std::vector<Field> berlekampMassey(const std::vector<Field>& sequence) { //shortest c with c[0] = 1 and sum c[k] * s[i - k] = 0
+  const Field zero = Field(0);
+  std::vector<Field> current = {Field(1)};
+  std::vector<Field> previous = {Field(1)};
+  size_t length = 0;
+  size_t shift = 1;
+  Field previousDiscrepancy = Field(1);
+  for (size_t n = 0; n < sequence.size(); ++n) {
+    Field discrepancy = sequence[n];
+    for (size_t i = 1; i <= length; ++i) {
+      discrepancy += current[i] * sequence[n - i];
+    }
+    if (discrepancy == zero) {
+      ++shift;
+      continue;
+    }
+    const Field factor = discrepancy / previousDiscrepancy;
+    std::vector<Field> updated = current;
+    if (updated.size() < previous.size() + shift) {
+      updated.resize(previous.size() + shift, zero);
+    }
+    for (size_t i = 0; i < previous.size(); ++i) {
+      updated[i + shift] -= factor * previous[i];
+    }
+    if (2 * length <= n) {
+      previous = current;
+      length = n + 1 - length;
+      previousDiscrepancy = discrepancy;
+      shift = 1;
+    } else {
+      ++shift;
+    }
+    current = std::move(updated);
+  }
+  current.resize(length + 1, zero);
+  return current;
+}
+
+//Wiedemann's method for a square non-singular system over a prime field: the minimal polynomial of the projected
+//Krylov sequence u * A^i * b is found by Berlekamp-Massey and A^-1 * b is read off it. Only matrix-vector products
+//are used, so the matrix is never modified. The result is verified and the projection is redrawn a few times
+template<size_t Modulus>
+std::optional<std::vector<Residue<Modulus>>> solveWiedemann(const SparseMatrix<Residue<Modulus>>& matrix,
+                                                             const std::vector<Residue<Modulus>>& rhs,
+                                                             uint64_t seed = 2024, size_t attempts = 3) {
+  using Element = Residue<Modulus>;
+  const size_t size = matrix.rows();
+  assert(matrix.columns() == size && rhs.size() == size && "Wiedemann solver expects a square system");
+  const Element zero(0);
+  if (std::all_of(rhs.begin(), rhs.end(), [&](const Element& value) { return value == zero; })) {
+    return std::vector<Element>(size, zero);
+  }
+
+  std::mt19937_64 generator(seed);
+  auto randomElement = [&] {
+    return Element(static_cast<ssize_t>((generator() >> 1) % Modulus));
+  };
+  for (size_t attempt = 0; attempt < attempts; ++attempt) {
+    std::vector<Element> projection(size);
+    for (auto& value : projection) {
+      value = randomElement();
+    }
+
+    std::vector<Element> sequence;
+    sequence.reserve(2 * size);
+    std::vector<Element> krylov = rhs;
+    for (size_t i = 0; i < 2 * size; ++i) {
+      Element value = zero;
+      for (size_t j = 0; j < size; ++j) {
+        value += projection[j] * krylov[j];
+      }
+      sequence.push_back(value);
+      if (i + 1 < 2 * size) {
+        krylov = matrix * krylov;
+      }
+    }
+
+    const std::vector<Element> connection = berlekampMassey(sequence);
+    const size_t degree = connection.size() - 1;
+    if (degree == 0 || connection[degree] == zero) {
+      continue;
+    }
+
+    std::vector<Element> result(size); //Horner: result = c[0] * A^(L-1) b + ... + c[L-1] * b
+    for (size_t j = 0; j < size; ++j) {
+      result[j] = connection[0] * rhs[j];
+    }
+    for (size_t k = 1; k < degree; ++k) {
+      result = matrix * result;
+      for (size_t j = 0; j < size; ++j) {
+        result[j] += connection[k] * rhs[j];
+      }
+    }
+    const Element factor = zero - connection[degree].inverted();
+    for (auto& value : result) {
+      value *= factor;
+    }
+    if (matrix * result == rhs) {
+      return result;
+    }
+  }
+  return std::nullopt;
+}
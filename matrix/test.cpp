@@ -0,0 +1,478 @@
+#include "matrix_io.h"
+#include "polynomial.h"
+#include "sparse_matrix.h"
+#include <cassert>
+#include <cmath>
+#include <iostream>
+#include <random>
+#include <sstream>
+
+using namespace std;
+
+void testMatrixStreamIO() {
+    // Две матрицы подряд в одном потоке читаются по одной
+    Matrix<2, 3, double> a = {{1.5, -2, 0}, {3, 4.25, -1e300}};
+    Matrix<2, 3, double> b = {{7, 8, 9}, {10, 11, 12}};
+    stringstream doubles;
+    MatrixIO::writeMatrix(doubles, a);
+    MatrixIO::writeMatrix(doubles, b);
+    Matrix<2, 3, double> ra;
+    Matrix<2, 3, double> rb;
+    assert(MatrixIO::readMatrix(doubles, ra) && ra == a);
+    assert(MatrixIO::readMatrix(doubles, rb) && rb == b);
+    assert(!MatrixIO::readMatrix(doubles, rb));
+
+    // То же для записей переменной длины
+    SquareMatrix<2, Rational> c = {{Rational(1), Rational(BigInteger(2), BigInteger(3))}, {Rational(-5), Rational("123456789012345678901234567890"_bi)}};
+    SquareMatrix<2, Rational> d = SquareMatrix<2, Rational>::unityMatrix();
+    stringstream rationals;
+    MatrixIO::writeMatrix(rationals, c);
+    MatrixIO::writeMatrix(rationals, d);
+    SquareMatrix<2, Rational> rc;
+    SquareMatrix<2, Rational> rd;
+    assert(MatrixIO::readMatrix(rationals, rc) && rc == c);
+    assert(MatrixIO::readMatrix(rationals, rd) && rd == d);
+
+    // Заголовок другого типа или размера отвергается, обрезанные данные — тоже
+    stringstream other;
+    MatrixIO::writeMatrix(other, a);
+    Matrix<3, 2, double> wrongShape;
+    assert(!MatrixIO::readMatrix(other, wrongShape));
+    string truncated;
+    {
+        stringstream full;
+        MatrixIO::writeMatrix(full, b);
+        truncated = full.str();
+        truncated.pop_back();
+    }
+    istringstream shortStream(truncated);
+    assert(!MatrixIO::readMatrix(shortStream, rb));
+}
+
+void testMappedMatrix() {
+    // Файл читается через mmap без загрузки; отсутствующий файл — невалидная матрица
+    SquareMatrix<3, Residue<998244353>> a = {{1, 2, 3}, {4, 5, 6}, {7, 8, 998244352}};
+    const string path = "matrix_test.bin";
+    assert(MatrixIO::saveMatrix(path, a));
+    SquareMatrix<3, Residue<998244353>> loaded;
+    assert(MatrixIO::loadMatrix(path, loaded) && loaded == a);
+    const MatrixIO::MappedMatrix<3, 3, Residue<998244353>> mapped(path);
+    assert(mapped.isValid());
+    for (size_t i = 0; i < 3; ++i) {
+        for (size_t j = 0; j < 3; ++j) {
+            assert((mapped[i, j] == a[i, j]));
+        }
+    }
+    remove(path.c_str());
+    using MappedResidues = MatrixIO::MappedMatrix<3, 3, Residue<998244353>>;
+    assert(!MappedResidues(path).isValid());
+}
+
+using Field = Residue<998244353>;
+
+template<size_t Rows, size_t Columns>
+Matrix<Rows, Columns, Field> randomMatrix(mt19937& generator, uint32_t range = 998244353) {
+    Matrix<Rows, Columns, Field> matrix;
+    for (size_t i = 0; i < Rows; ++i) {
+        for (size_t j = 0; j < Columns; ++j) {
+            matrix[i, j] = Field(static_cast<ssize_t>(generator() % range));
+        }
+    }
+    return matrix;
+}
+
+void testPLUDecomposition() {
+    // solve, det и inverse совпадают с det() и inverted() метода Гаусса
+    mt19937 generator(30);
+    for (int test = 0; test < 20; ++test) {
+        const SquareMatrix<7, Field> a = randomMatrix<7, 7>(generator);
+        const PLUDecomposition<7, Field> plu(a);
+        assert(!plu.isSingular());
+        assert(plu.det() == a.det());
+        assert(plu.inverse() == a.inverted());
+        array<Field, 7> rhs;
+        for (Field& value : rhs) {
+            value = Field(static_cast<ssize_t>(generator() % 1000));
+        }
+        const array<Field, 7> x = plu.solve(rhs);
+        for (size_t i = 0; i < 7; ++i) {
+            Field sum = Field(0);
+            for (size_t j = 0; j < 7; ++j) {
+                sum += a[i, j] * x[j];
+            }
+            assert(sum == rhs[i]);
+        }
+    }
+
+    // Рациональные числа: точный ответ
+    SquareMatrix<3, Rational> r = {{Rational(2), Rational(1), Rational(1)}, {Rational(1), Rational(3), Rational(2)}, {Rational(1), Rational(0), Rational(0)}};
+    const PLUDecomposition<3, Rational> rationalPlu(r);
+    assert(rationalPlu.det() == r.det() && r.det() == Rational(-1));
+    assert(rationalPlu.inverse() == r.inverted());
+    assert(rationalPlu.inverse() * r == (SquareMatrix<3, Rational>::unityMatrix()));
+
+    // Перестановка строк нужна только в последнем столбце и в размере 1
+    SquareMatrix<3, Field> lastColumn = {{1, 2, 3}, {0, 1, 4}, {0, 0, 5}};
+    assert((PLUDecomposition<3, Field>(lastColumn).det() == Field(5)));
+    SquareMatrix<2, Field> swapped = {{0, 1}, {1, 0}};
+    const PLUDecomposition<2, Field> swappedPlu(swapped);
+    assert(swappedPlu.det() == Field(-1));
+    assert(swappedPlu.inverse() == swapped);
+    SquareMatrix<1, Field> single = {{4}};
+    assert((PLUDecomposition<1, Field>(single).solve({Field(8)})[0] == Field(2)));
+
+    // Вырожденные матрицы: нулевой последний столбец и линейно зависимые строки
+    SquareMatrix<3, Field> zeroColumn = {{1, 2, 0}, {3, 4, 0}, {5, 6, 0}};
+    assert((PLUDecomposition<3, Field>(zeroColumn).isSingular()));
+    assert((PLUDecomposition<3, Field>(zeroColumn).det() == Field(0)));
+    assert(zeroColumn.det() == Field(0));
+    SquareMatrix<3, Rational> dependent = {{Rational(1), Rational(2), Rational(3)}, {Rational(2), Rational(4), Rational(6)}, {Rational(0), Rational(1), Rational(1)}};
+    assert((PLUDecomposition<3, Rational>(dependent).isSingular()));
+    assert(dependent.rank() == 2);
+}
+
+void testRectangularRank() {
+    // Ранг прямоугольных матриц: столбцов больше строк и наоборот
+    Matrix<2, 4, Rational> wide = {{Rational(1), Rational(2), Rational(3), Rational(4)}, {Rational(2), Rational(4), Rational(6), Rational(8)}};
+    assert(wide.rank() == 1);
+    wide[1, 3] = Rational(9);
+    assert(wide.rank() == 2);
+    assert(wide.transposed().rank() == 2);
+    Matrix<4, 2, Field> tall = {{0, 0}, {0, 0}, {0, 0}, {0, 7}};
+    assert(tall.rank() == 1);
+    mt19937 generator(27);
+    assert((randomMatrix<3, 6>(generator).rank() == 3));
+    assert((randomMatrix<6, 3>(generator).rank() == 3));
+    assert((Matrix<3, 5, Field>().rank() == 0));
+}
+
+template<size_t Size>
+SparseMatrix<Field> randomSparse(mt19937& generator, size_t perRow) { //non-zero diagonal plus perRow random entries per row
+    vector<SparseMatrix<Field>::Entry> entries;
+    for (size_t i = 0; i < Size; ++i) {
+        entries.emplace_back(i, i, Field(static_cast<ssize_t>(1 + generator() % 1000)));
+        for (size_t k = 0; k < perRow; ++k) {
+            entries.emplace_back(i, generator() % Size, Field(static_cast<ssize_t>(generator() % 1000)));
+        }
+    }
+    return SparseMatrix<Field>(Size, Size, entries);
+}
+
+template<size_t Size>
+SquareMatrix<Size, Field> toDense(const SparseMatrix<Field>& sparse) {
+    SquareMatrix<Size, Field> dense;
+    for (size_t i = 0; i < Size; ++i) {
+        for (size_t j = 0; j < Size; ++j) {
+            dense[i, j] = sparse.at(i, j);
+        }
+    }
+    return dense;
+}
+
+void testSparseSolve() {
+    // solve и solveWiedemann дают то же решение, что и плотное PLU-разложение
+    constexpr size_t kSize = 30;
+    mt19937 generator(33);
+    for (int test = 0; test < 20; ++test) {
+        const SparseMatrix<Field> sparse = randomSparse<kSize>(generator, 1 + test % 3);
+        const SquareMatrix<kSize, Field> dense = toDense<kSize>(sparse);
+        const PLUDecomposition<kSize, Field> plu(dense);
+        if (plu.isSingular()) {
+            assert(!sparse.solve(vector<Field>(kSize, Field(1))).has_value());
+            continue;
+        }
+        array<Field, kSize> rhs;
+        for (Field& value : rhs) {
+            value = Field(static_cast<ssize_t>(generator() % 1000));
+        }
+        const array<Field, kSize> expected = plu.solve(rhs);
+        const vector<Field> rhsVector(rhs.begin(), rhs.end());
+        const vector<Field> expectedVector(expected.begin(), expected.end());
+        assert(sparse.solve(rhsVector) == expectedVector);
+        assert(solveWiedemann(sparse, rhsVector) == expectedVector);
+        assert(sparse * expectedVector == rhsVector);
+    }
+
+    // Вырожденная система: две одинаковые строки
+    vector<SparseMatrix<Field>::Entry> entries = {{0, 0, Field(1)}, {0, 2, Field(2)}, {1, 1, Field(3)}, {2, 0, Field(1)}, {2, 2, Field(2)}};
+    const SparseMatrix<Field> singular(3, 3, entries);
+    assert(!singular.solve({Field(1), Field(2), Field(3)}).has_value());
+    assert(!singular.solve({Field(1), Field(2), Field(1)}).has_value());
+    assert(!solveWiedemann(singular, {Field(1), Field(2), Field(3)}).has_value());
+}
+
+void testSparseProducts() {
+    // Произведения на плотную матрицу и вектор совпадают с плотными
+    constexpr size_t kSize = 12;
+    mt19937 generator(34);
+    const SparseMatrix<Field> sparse = randomSparse<kSize>(generator, 2);
+    const SquareMatrix<kSize, Field> dense = toDense<kSize>(sparse);
+    const Matrix<kSize, 5, Field> other = randomMatrix<kSize, 5>(generator);
+    assert((sparse.multiply<kSize, kSize, 5>(other) == dense * other));
+    assert((toDense<kSize>(sparse.transposed()) == dense.transposed()));
+    assert((toDense<kSize>(SparseMatrix<Field>::fromDense(dense)) == dense));
+
+    // Дубликаты складываются, нули отбрасываются
+    const SparseMatrix<Field> summed(2, 2, {{0, 1, Field(2)}, {0, 1, Field(3)}, {1, 0, Field(0)}});
+    assert(summed.nonZeros() == 1 && summed.at(0, 1) == Field(5));
+}
+
+void testBerlekampMassey() {
+    // Числа Фибоначчи: s[i] = s[i - 1] + s[i - 2], то есть c = {1, -1, -1}
+    vector<Field> fibonacci = {Field(0), Field(1)};
+    for (int i = 2; i < 20; ++i) {
+        fibonacci.push_back(fibonacci[i - 1] + fibonacci[i - 2]);
+    }
+    assert((berlekampMassey(fibonacci) == vector<Field>{Field(1), Field(-1), Field(-1)}));
+
+    // Геометрическая прогрессия и нулевая последовательность
+    vector<Field> powers = {Field(1)};
+    for (int i = 1; i < 10; ++i) {
+        powers.push_back(powers.back() * Field(3));
+    }
+    assert((berlekampMassey(powers) == vector<Field>{Field(1), Field(-3)}));
+    assert((berlekampMassey(vector<Field>(8, Field(0))) == vector<Field>{Field(1)}));
+}
+
+template<size_t Size, typename Number>
+void checkBatch(mt19937& generator) {
+    // 150 матриц: больше одного блока kLaneBlock, последний блок неполный
+    vector<SquareMatrix<Size, Number>> matrices;
+    while (matrices.size() < 150) {
+        SquareMatrix<Size, Number> matrix;
+        for (size_t i = 0; i < Size; ++i) {
+            for (size_t j = 0; j < Size; ++j) {
+                matrix[i, j] = Number(static_cast<int>(generator() % 19) - 9);
+            }
+        }
+        if (!PLUDecomposition<Size, Number>(matrix).isSingular()) {
+            matrices.push_back(matrix);
+        }
+    }
+    auto close = [](const Number& lhs, const Number& rhs) {
+        if constexpr (is_floating_point_v<Number>) {
+            return fabs(lhs - rhs) <= 1e-9 * max(1.0, fabs(rhs));
+        } else {
+            return lhs == rhs;
+        }
+    };
+    const MatrixBatch<Size, Number> batch(matrices);
+    const MatrixBatch<Size, Number> inverses = batch.inverted();
+    const vector<Number> determinants = batch.det();
+    const MatrixBatch<Size, Number> squares = batch * batch;
+    for (size_t index = 0; index < matrices.size(); ++index) {
+        const PLUDecomposition<Size, Number> plu(matrices[index]);
+        const SquareMatrix<Size, Number> inverse = plu.inverse();
+        const SquareMatrix<Size, Number> square = matrices[index] * matrices[index];
+        assert(close(determinants[index], plu.det()));
+        assert((batch.matrix(index) == matrices[index]));
+        for (size_t i = 0; i < Size; ++i) {
+            for (size_t j = 0; j < Size; ++j) {
+                assert(close(inverses[index, i, j], inverse[i, j]));
+                assert(close(squares[index, i, j], square[i, j]));
+            }
+        }
+    }
+}
+
+void testMatrixBatch() {
+    // Пакетные det, inverted и умножение поэлементно совпадают с PLU-разложением и обычным умножением
+    mt19937 generator(34);
+    checkBatch<3, double>(generator);
+    checkBatch<4, double>(generator);
+    checkBatch<8, double>(generator);
+    checkBatch<3, Field>(generator);
+    checkBatch<4, Field>(generator);
+    checkBatch<8, Field>(generator);
+
+    // Определитель вырожденной матрицы в пакете равен нулю
+    MatrixBatch<3, Field> batch(2);
+    batch.setMatrix(0, {{1, 2, 3}, {2, 4, 6}, {0, 1, 1}});
+    batch.setMatrix(1, {{2, 0, 0}, {0, 3, 0}, {0, 0, 4}});
+    const vector<Field> determinants = batch.det();
+    assert(determinants[0] == Field(0) && determinants[1] == Field(24));
+}
+
+template<size_t Size, typename Number>
+SquareMatrix<Size, Number> evaluateAt(const vector<Number>& polynomial, const SquareMatrix<Size, Number>& matrix) { //Horner over matrices
+    SquareMatrix<Size, Number> result;
+    for (size_t k = polynomial.size(); k-- > 0;) {
+        result = result * matrix;
+        for (size_t i = 0; i < Size; ++i) {
+            result[i, i] += polynomial[k];
+        }
+    }
+    return result;
+}
+
+void testCharacteristicPolynomial() {
+    // Хессенберг и Берковиц совпадают, выполняется теорема Гамильтона-Кэли, минимальный многочлен делит характеристический
+    mt19937 generator(39);
+    for (int test = 0; test < 10; ++test) {
+        const SquareMatrix<6, Field> a = randomMatrix<6, 6>(generator, test < 5 ? 3 : 998244353);
+        const vector<Field> hessenberg = hessenbergCharacteristicPolynomial(a);
+        assert(hessenberg.size() == 7 && hessenberg.back() == Field(1));
+        assert(hessenberg == berkowitzCharacteristicPolynomial(a));
+        assert((evaluateAt(hessenberg, a) == SquareMatrix<6, Field>()));
+        assert(hessenberg[0] == a.det());
+        const vector<Field> minimal = minimalPolynomial(a);
+        assert(minimal.back() == Field(1));
+        assert((evaluateAt(minimal, a) == SquareMatrix<6, Field>()));
+        assert((Polynomial<Field>(hessenberg) % Polynomial<Field>(minimal)).isZero());
+    }
+
+    // Целые числа через Берковица совпадают с рациональными через Хессенберга
+    SquareMatrix<4, BigInteger> integers;
+    SquareMatrix<4, Rational> rationals;
+    for (size_t i = 0; i < 4; ++i) {
+        for (size_t j = 0; j < 4; ++j) {
+            const int value = static_cast<int>(generator() % 21) - 10;
+            integers[i, j] = BigInteger(value);
+            rationals[i, j] = Rational(value);
+        }
+    }
+    const vector<BigInteger> integerPolynomial = characteristicPolynomial(integers);
+    const vector<Rational> rationalPolynomial = characteristicPolynomial(rationals);
+    for (size_t k = 0; k <= 4; ++k) {
+        assert(Rational(integerPolynomial[k]) == rationalPolynomial[k]);
+    }
+
+    // Скалярная матрица (вырожденный случай): характеристический (x - 5)^4, минимальный x - 5
+    const SquareMatrix<4, Field> scalar = SquareMatrix<4, Field>::unityMatrix() * Field(5);
+    assert((hessenbergCharacteristicPolynomial(scalar) == vector<Field>{Field(625), Field(-500), Field(150), Field(-20), Field(1)}));
+    assert((minimalPolynomial(scalar) == vector<Field>{Field(-5), Field(1)}));
+
+    // Жорданова клетка 2x2 и клетка 1x1 с тем же собственным числом: минимальный (x - 2)^2
+    SquareMatrix<3, Rational> jordan = {{Rational(2), Rational(1), Rational(0)}, {Rational(0), Rational(2), Rational(0)}, {Rational(0), Rational(0), Rational(2)}};
+    assert((minimalPolynomial(jordan) == vector<Rational>{Rational(4), Rational(-4), Rational(1)}));
+    assert((characteristicPolynomial(jordan) == vector<Rational>{Rational(-8), Rational(12), Rational(-6), Rational(1)}));
+}
+
+template<typename Number>
+vector<Number> naiveProduct(const vector<Number>& lhs, const vector<Number>& rhs) {
+    vector<Number> result(lhs.size() + rhs.size() - 1, Number(0));
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        for (size_t j = 0; j < rhs.size(); ++j) {
+            result[i + j] += lhs[i] * rhs[j];
+        }
+    }
+    return result;
+}
+
+template<typename Number>
+Polynomial<Number> randomPolynomial(mt19937& generator, size_t size) { //non-zero leading coefficient
+    vector<Number> coefficients(size);
+    for (Number& value : coefficients) {
+        value = Number(static_cast<ssize_t>(generator() % 1000000));
+    }
+    coefficients.back() = Number(static_cast<ssize_t>(1 + generator() % 1000));
+    return Polynomial<Number>(coefficients);
+}
+
+void testPolynomialMultiplication() {
+    // Произведение совпадает с наивным: короткое (школьное), длинное (NTT) и по модулю без корней из единицы (три простых и КТО)
+    mt19937 generator(40);
+    for (size_t size : {size_t(1), size_t(5), size_t(40), size_t(300), size_t(2000)}) {
+        const Polynomial<Field> lhs = randomPolynomial<Field>(generator, size);
+        const Polynomial<Field> rhs = randomPolynomial<Field>(generator, size + 3);
+        assert((lhs * rhs).coefficients() == naiveProduct(lhs.coefficients(), rhs.coefficients()));
+        using Other = Residue<1000000007>;
+        const Polynomial<Other> otherLhs = randomPolynomial<Other>(generator, size);
+        const Polynomial<Other> otherRhs = randomPolynomial<Other>(generator, size + 1);
+        assert((otherLhs * otherRhs).coefficients() == naiveProduct(otherLhs.coefficients(), otherRhs.coefficients()));
+    }
+
+    // double через комплексное БПФ: совпадает с точностью до округления
+    vector<double> left(500);
+    vector<double> right(700);
+    for (double& value : left) {
+        value = static_cast<double>(generator() % 100);
+    }
+    for (double& value : right) {
+        value = static_cast<double>(generator() % 100);
+    }
+    const vector<double> product = (Polynomial<double>(left) * Polynomial<double>(right)).coefficients();
+    const vector<double> expected = naiveProduct(left, right);
+    assert(product.size() == expected.size());
+    for (size_t i = 0; i < product.size(); ++i) {
+        assert(fabs(product[i] - expected[i]) < 1e-6 * max(1.0, expected[i]));
+    }
+}
+
+void testPolynomialDivision() {
+    // dividend = divisor * quotient + remainder, степень остатка меньше степени делителя; короткие и длинные частные
+    mt19937 generator(41);
+    for (auto [dividendSize, divisorSize] : {pair<size_t, size_t>{10, 3}, {300, 20}, {2000, 700}, {2000, 1990}, {5, 9}}) {
+        const Polynomial<Field> dividend = randomPolynomial<Field>(generator, dividendSize);
+        const Polynomial<Field> divisor = randomPolynomial<Field>(generator, divisorSize);
+        const auto [quotient, remainder] = Polynomial<Field>::divide(dividend, divisor);
+        assert(divisor * quotient + remainder == dividend);
+        assert(remainder.degree() < divisor.degree());
+        assert(dividend / divisor == quotient && dividend % divisor == remainder);
+    }
+    const Polynomial<Rational> rationalDividend = {Rational(1), Rational(0), Rational(0), Rational(2)};
+    const Polynomial<Rational> rationalDivisor = {Rational(1), Rational(2)};
+    assert(rationalDivisor * (rationalDividend / rationalDivisor) + rationalDividend % rationalDivisor == rationalDividend);
+}
+
+void testInverseSeries() {
+    // p * (1 / p) = 1 + O(x^terms)
+    mt19937 generator(42);
+    for (size_t terms : {size_t(1), size_t(7), size_t(64), size_t(1000)}) {
+        Polynomial<Field> p = randomPolynomial<Field>(generator, 300);
+        vector<Field> coefficients = p.coefficients();
+        coefficients[0] = Field(static_cast<ssize_t>(1 + generator() % 1000));
+        p = Polynomial<Field>(coefficients);
+        const Polynomial<Field> inverse = p.inverseSeries(terms);
+        const Polynomial<Field> product = p * inverse;
+        assert(product[0] == Field(1));
+        for (size_t i = 1; i < terms; ++i) {
+            assert(product[i] == Field(0));
+        }
+    }
+    // 1 / (1 - x) = 1 + x + x^2 + ...
+    const Polynomial<Rational> geometric = Polynomial<Rational>{Rational(1), Rational(-1)}.inverseSeries(6);
+    assert((geometric == Polynomial<Rational>{Rational(1), Rational(1), Rational(1), Rational(1), Rational(1), Rational(1)}));
+}
+
+void testMultipointEvaluation() {
+    // Значения через дерево подпроизведений совпадают со схемой Горнера
+    mt19937 generator(43);
+    for (size_t count : {size_t(3), size_t(100), size_t(1500)}) {
+        const Polynomial<Field> p = randomPolynomial<Field>(generator, 1000);
+        vector<Field> points(count);
+        for (Field& point : points) {
+            point = Field(static_cast<ssize_t>(generator() % 998244353));
+        }
+        const vector<Field> values = p.evaluate(points);
+        for (size_t i = 0; i < count; ++i) {
+            assert(values[i] == p(points[i]));
+        }
+    }
+}
+
+int main() {
+    // Тесты ввода-вывода
+    testMatrixStreamIO();
+    testMappedMatrix();
+
+    // Тесты метода Гаусса и PLU-разложения
+    testPLUDecomposition();
+    testRectangularRank();
+    testMatrixBatch();
+    testCharacteristicPolynomial();
+
+    // Тесты многочленов
+    testPolynomialMultiplication();
+    testPolynomialDivision();
+    testInverseSeries();
+    testMultipointEvaluation();
+
+    // Тесты разреженных матриц
+    testSparseSolve();
+    testSparseProducts();
+    testBerlekampMassey();
+
+    cout << "All tests passed!" << endl;
+    return 0;
+}